@@ -0,0 +1,484 @@
+// Local referee playing many self-play games in parallel, build with:
+//   g++ -std=c++17 -O2 -pthread -o arena arena.cpp
+// Bots are given as a comma separated list of 2 to 4 entries:
+//   search            the full bot, heuristic plus search, in process
+//   evolution         the heuristic plus rolling horizon evolution, in process
+//   baseline          the Character heuristic alone, in process
+//   cmd:<command>     any program speaking the referee protocol on stdin/stdout
+// e.g. arena --bots search,baseline --games 40 --budget 20
+// Define ARENA_NO_MAIN to reuse the games from another tool.
+#define HYPERSONIC_NO_MAIN
+#define HYPERSONIC_LOG_LEVEL 0
+#include "hypersonic.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <sys/wait.h>
+
+namespace
+{
+
+const Position start_corners[GameState::max_players] = {
+    {0, 0}, {field_height - 1, field_width - 1}, {0, field_width - 1}, {field_height - 1, 0}
+};
+
+// Walls on every odd row and column, 30 to 65 boxes mirrored into the four quadrants,
+// the corners and the cells next to them kept clear
+GameState new_game( uint64_t seed, int players )
+{
+    Random rng( seed * 0x9E3779B97F4A7C15ull );
+    char grid[field_height][field_width + 1];
+    for( int r = 0; r < field_height; r++ )
+    {
+        for( int c = 0; c < field_width; c++ )
+        {
+            grid[r][c] = r % 2 && c % 2 ? 'X' : '.';
+        }
+        grid[r][field_width] = 0;
+    }
+
+    const int target = 30 + rng.below( 36 );
+    int boxes = 0;
+    for( int attempt = 0; attempt < 1000 && boxes < target; attempt++ )
+    {
+        const int r = rng.below( field_height / 2 + 1 );
+        const int c = rng.below( field_width / 2 + 1 );
+        if( grid[r][c] != '.' || r + c <= 1 ) continue;
+
+        const Position mirrors[4] = {
+            {r, c}, {r, field_width - 1 - c}, {field_height - 1 - r, c}, {field_height - 1 - r, field_width - 1 - c}
+        };
+        int added = 0;
+        for( const Position& m: mirrors )
+        {
+            if( grid[m.row][m.col] == '.' ) added++, grid[m.row][m.col] = '?';
+        }
+        if( boxes + added > 65 )
+        {
+            for( const Position& m: mirrors )
+            {
+                if( grid[m.row][m.col] == '?' ) grid[m.row][m.col] = '.';
+            }
+            continue;
+        }
+
+        const int kind = rng.below( 4 );
+        const char box = kind == 0 ? '1' : kind == 1 ? '2' : '0';
+        for( const Position& m: mirrors )
+        {
+            if( grid[m.row][m.col] == '?' ) grid[m.row][m.col] = box;
+        }
+        boxes += added;
+    }
+
+    GameState s;
+    for( int r = 0; r < field_height; r++ )
+    {
+        s.load_row( r, grid[r] );
+    }
+    for( int id = 0; id < players; id++ )
+    {
+        s.add_player( id, start_corners[id], 1, 3 );
+    }
+    return s;
+}
+
+char cell_symbol( const GameState& s, int i )
+{
+    if( s.board.walls.test( i ) ) return 'X';
+    if( s.board.range_boxes.test( i ) ) return '1';
+    if( s.board.count_boxes.test( i ) ) return '2';
+    if( s.board.boxes.test( i ) ) return '0';
+    return '.';
+}
+
+// The referee's view of the turn: grid rows then every entity
+string turn_text( const GameState& s )
+{
+    string text;
+    for( int i = 0; i < field_cells; i++ )
+    {
+        text += cell_symbol( s, i );
+        if( i % field_width == field_width - 1 ) text += '\n';
+    }
+
+    vector<string> entities;
+    auto entity = [&]( int type, int owner, int cell, int param1, int param2 ){
+        const Position p = cell_position( cell );
+        entities.push_back( to_string( type ) + " " + to_string( owner ) + " " + to_string( p.col ) + " " +
+                            to_string( p.row ) + " " + to_string( param1 ) + " " + to_string( param2 ) );
+    };
+    for( int id = 0; id < GameState::max_players; id++ )
+    {
+        const GameState::Player& player = s.players[id];
+        if( player.alive ) entity( Entities::character, id, player.cell, player.bombs, player.range );
+    }
+    s.board.bombs.for_each( [&]( int b ){ entity( Entities::bomb, s.bomb_owner[b], b, s.bomb_timer[b], s.bomb_range[b] ); } );
+    s.board.range_items.for_each( [&]( int i ){ entity( Entities::item, 0, i, 1, 0 ); } );
+    s.board.count_items.for_each( [&]( int i ){ entity( Entities::item, 0, i, 2, 0 ); } );
+
+    text += to_string( entities.size() ) + "\n";
+    for( const string& e: entities ) text += e + "\n";
+    return text;
+}
+
+// "MOVE x y" or "BOMB x y" in any case, anything else stays put
+Action parse_command( const string& command, int cell )
+{
+    int x;
+    int y;
+    char verb[8] = {};
+    if( sscanf( command.c_str(), "%7s %d %d", verb, &x, &y ) != 3 ||
+        x < 0 || x >= field_width || y < 0 || y >= field_height )
+    {
+        return Action::move( cell_position( cell ) );
+    }
+    return ( verb[0] == 'B' || verb[0] == 'b' ) ? Action::bomb( {y, x} ) : Action::move( {y, x} );
+}
+
+// A bot program on the other end of a pair of pipes
+struct Process
+{
+    bool start( const string& command )
+    {
+        int to_child[2];
+        int from_child[2];
+        if( pipe( to_child ) || pipe( from_child ) ) return false;
+        pid = fork();
+        if( pid == 0 )
+        {
+            dup2( to_child[0], 0 );
+            dup2( from_child[1], 1 );
+            close( to_child[0] );
+            close( to_child[1] );
+            close( from_child[0] );
+            close( from_child[1] );
+            execl( "/bin/sh", "sh", "-c", command.c_str(), (char*)nullptr );
+            _exit( 127 );
+        }
+        close( to_child[0] );
+        close( from_child[1] );
+        to = fdopen( to_child[1], "w" );
+        from = from_child[0];
+        return pid > 0 && to;
+    }
+
+    void send( const string& text )
+    {
+        fputs( text.c_str(), to );
+        fflush( to );
+    }
+
+    // The next line the program writes, false if it doesn't come by the deadline or the program is gone
+    bool ask( const string& text, chrono::steady_clock::time_point deadline, string& line )
+    {
+        send( text );
+        size_t end;
+        while( ( end = pending.find( '\n' ) ) == string::npos )
+        {
+            // rounded up, a timeout is always past the deadline
+            const auto left = chrono::ceil<chrono::milliseconds>( deadline - chrono::steady_clock::now() );
+            pollfd ready = { from, POLLIN, 0 };
+            if( left.count() <= 0 || poll( &ready, 1, (int)left.count() ) <= 0 ) return false;
+            char buffer[256];
+            const ssize_t n = read( from, buffer, sizeof buffer );
+            if( n <= 0 ) return false;
+            pending.append( buffer, n );
+        }
+        line = pending.substr( 0, end );
+        pending.erase( 0, end + 1 );
+        return true;
+    }
+
+    // Kills the program too, one that missed its deadline may still be thinking
+    void stop()
+    {
+        if( to ) fclose( to );
+        if( from >= 0 ) close( from );
+        if( pid > 0 )
+        {
+            kill( pid, SIGKILL );
+            waitpid( pid, nullptr, 0 );
+        }
+        to = nullptr;
+        from = -1;
+        pid = -1;
+    }
+
+    pid_t pid = -1;
+    FILE* to = nullptr;
+    int from = -1;
+    string pending;     // read past the last line asked for
+};
+
+// One bot in one game
+struct Seat
+{
+    Seat( const string& kind, int id, const CharacterParams& params )
+    {
+        if( kind.compare( 0, 4, "cmd:" ) == 0 )
+        {
+            process.start( kind.substr( 4 ) );
+            process.send( to_string( field_width ) + " " + to_string( field_height ) + " " + to_string( id ) + "\n" );
+        }
+        else
+        {
+            const Engine engine = kind == "search" ? Engine::search : kind == "evolution" ? Engine::evolution : Engine::heuristic;
+            bot = make_unique<Bot>( id, engine, 1, params ); // the games already run in parallel
+        }
+    }
+
+    ~Seat()
+    {
+        process.stop();
+    }
+
+    // False when a program doesn't answer within the referee's limit, the referee takes it out then
+    bool decide( const GameState& s, chrono::milliseconds budget, string& command )
+    {
+        if( !bot )
+        {
+            return process.ask( turn_text( s ), chrono::steady_clock::now() + TimeManager::referee_limit( s.turn ), command );
+        }
+
+        bot->start_turn();
+        for( int r = 0; r < field_height; r++ )
+        {
+            char row[field_width];
+            for( int c = 0; c < field_width; c++ )
+            {
+                row[c] = cell_symbol( s, r * field_width + c );
+            }
+            bot->read_row( r, row, field_width );
+        }
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            const GameState::Player& player = s.players[id];
+            if( !player.alive ) continue;
+            const Position p = cell_position( player.cell );
+            bot->read_entity( Entities::character, id, p.col, p.row, player.bombs, player.range );
+        }
+        s.board.bombs.for_each( [&]( int b ){
+            const Position p = cell_position( b );
+            bot->read_entity( Entities::bomb, s.bomb_owner[b], p.col, p.row, s.bomb_timer[b], s.bomb_range[b] );
+        } );
+        s.board.range_items.for_each( [&]( int i ){
+            const Position p = cell_position( i );
+            bot->read_entity( Entities::item, 0, p.col, p.row, 1, 0 );
+        } );
+        s.board.count_items.for_each( [&]( int i ){
+            const Position p = cell_position( i );
+            bot->read_entity( Entities::item, 0, p.col, p.row, 2, 0 );
+        } );
+        command = bot->decide( chrono::steady_clock::now(), budget );
+        return true;
+    }
+
+    unique_ptr<Bot> bot;
+    Process process;
+};
+
+// Referee ranking: outlasting wins, players out on the same turn are ranked by boxes destroyed.
+// -1 when the first place is shared.
+int winner( const GameState& s, int players )
+{
+    int best = -1;
+    long long best_key = LLONG_MIN;
+    bool shared = false;
+    for( int id = 0; id < players; id++ )
+    {
+        const GameState::Player& player = s.players[id];
+        const long long out = player.alive ? INT_MAX : player.eliminated_turn;
+        const long long key = out * 1000 + player.boxes;
+        if( key > best_key )
+        {
+            best = id;
+            best_key = key;
+            shared = false;
+        }
+        else if( key == best_key )
+        {
+            shared = true;
+        }
+    }
+    return shared ? -1 : best;
+}
+
+struct Results
+{
+    mutex lock;
+    vector<int> wins;
+    vector<int> late;           // program answers past the referee's limit, or none at all
+    int draws = 0;
+    int games = 0;
+    vector<vector<double>> turn_ms;
+};
+
+struct Options
+{
+    vector<string> bots = { "search", "baseline" };
+    int games = 20;
+    int threads = 0;
+    uint64_t seed = 1;
+    int budget_ms = 20;
+    vector<CharacterParams> params;   // per bot, the compiled in defaults when empty
+};
+
+// A player out of the game on this turn without a blast, as when it times out
+void forfeit( GameState& s, int id )
+{
+    s.hash ^= s.player_key( id );
+    s.players[id].alive = false;
+    s.players[id].eliminated_turn = s.turn;
+    s.hash ^= s.player_key( id );
+}
+
+// Seats rotate between games so every bot plays every corner
+void play( const Options& options, uint64_t game, Results& results )
+{
+    const int players = (int)options.bots.size();
+    GameState state = new_game( options.seed + game, players );
+
+    vector<unique_ptr<Seat>> seats( players );
+    vector<int> bot_of( players );
+    for( int id = 0; id < players; id++ )
+    {
+        bot_of[id] = (int)( ( id + game ) % players );
+        const CharacterParams& params = options.params.empty() ? default_character_params : options.params[bot_of[id]];
+        seats[id] = make_unique<Seat>( options.bots[bot_of[id]], id, params );
+    }
+
+    vector<vector<double>> turn_ms( players );
+    vector<int> late( players, 0 );
+    while( !state.finished )
+    {
+        // the budget stands in for the referee's 100 ms, the first turn gets ten of them as it does there
+        const chrono::milliseconds budget( options.budget_ms * TimeManager::referee_limit( state.turn ).count() /
+                                           TimeManager::referee_limit( 1 ).count() );
+        Action actions[GameState::max_players];
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            const GameState::Player& player = state.players[id];
+            actions[id] = Action::move( cell_position( player.cell == GameState::nowhere ? 0 : player.cell ) );
+            if( id >= players || !player.alive ) continue;
+
+            const auto start = chrono::steady_clock::now();
+            string command;
+            const bool answered = seats[id]->decide( state, budget, command );
+            const chrono::duration<double, milli> spent = chrono::steady_clock::now() - start;
+            turn_ms[bot_of[id]].push_back( spent.count() );
+            if( answered ) actions[id] = parse_command( command, player.cell );
+            else forfeit( state, id );
+            if( !seats[id]->bot && ( !answered || spent > TimeManager::referee_limit( state.turn ) ) ) late[bot_of[id]]++;
+        }
+        state.step( actions );
+    }
+
+    const int first = winner( state, players );
+    lock_guard<mutex> guard( results.lock );
+    results.games++;
+    if( first < 0 ) results.draws++;
+    else results.wins[bot_of[first]]++;
+    for( int b = 0; b < players; b++ )
+    {
+        results.late[b] += late[b];
+        results.turn_ms[b].insert( results.turn_ms[b].end(), turn_ms[b].begin(), turn_ms[b].end() );
+    }
+}
+
+} // namespace
+
+#ifndef ARENA_NO_MAIN
+namespace
+{
+
+double percentile( vector<double>& times, double p )
+{
+    if( times.empty() ) return 0;
+    sort( times.begin(), times.end() );
+    return times[min( times.size() - 1, (size_t)( p * times.size() ) )];
+}
+
+vector<string> split( const string& list )
+{
+    vector<string> items;
+    size_t from = 0;
+    for( size_t comma; ( comma = list.find( ',', from ) ) != string::npos; from = comma + 1 )
+    {
+        items.push_back( list.substr( from, comma - from ) );
+    }
+    items.push_back( list.substr( from ) );
+    return items;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    // a program that died is forfeited, not a reason for the arena to die too
+    signal( SIGPIPE, SIG_IGN );
+    Options options;
+    for( int a = 1; a + 1 < argc; a += 2 )
+    {
+        if( !strcmp( argv[a], "--bots" ) ) options.bots = split( argv[a + 1] );
+        else if( !strcmp( argv[a], "--games" ) ) options.games = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--threads" ) ) options.threads = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--seed" ) ) options.seed = strtoull( argv[a + 1], nullptr, 10 );
+        else if( !strcmp( argv[a], "--budget" ) ) options.budget_ms = atoi( argv[a + 1] );
+    }
+    if( options.bots.size() < 2 || options.bots.size() > (size_t)GameState::max_players )
+    {
+        fprintf( stderr, "usage: %s [--bots a,b[,c[,d]]] [--games n] [--threads n] [--seed s] [--budget ms]\n", argv[0] );
+        return 2;
+    }
+    if( options.threads <= 0 ) options.threads = max( 1u, thread::hardware_concurrency() );
+
+    Results results;
+    results.wins.assign( options.bots.size(), 0 );
+    results.late.assign( options.bots.size(), 0 );
+    results.turn_ms.assign( options.bots.size(), {} );
+
+    const auto start = chrono::steady_clock::now();
+    atomic<int> next_game( 0 );
+    vector<thread> workers;
+    for( int t = 0; t < options.threads; t++ )
+    {
+        workers.emplace_back( [&]{
+            for( int g; ( g = next_game++ ) < options.games; )
+            {
+                play( options, (uint64_t)g, results );
+            }
+        } );
+    }
+    for( thread& w: workers ) w.join();
+    const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+
+    printf( "games %d, draws %d, %.2f games/sec on %d threads\n", results.games, results.draws,
+            results.games / elapsed.count(), options.threads );
+    for( size_t b = 0; b < options.bots.size(); b++ )
+    {
+        vector<double>& times = results.turn_ms[b];
+        const double p50 = percentile( times, 0.50 );
+        const double p99 = percentile( times, 0.99 );
+        printf( "%-12s win rate %5.1f%%, turn p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", options.bots[b].c_str(),
+                100.0 * results.wins[b] / max( 1, results.games ), p50, p99, times.empty() ? 0.0 : times.back() );
+    }
+
+    // a program seat plays under the referee's clock, one late answer loses a real game
+    int failed = 0;
+    for( size_t b = 0; b < options.bots.size(); b++ )
+    {
+        if( !results.late[b] ) continue;
+        fprintf( stderr, "%s: %d turns answered late or not at all\n", options.bots[b].c_str(), results.late[b] );
+        failed = 1;
+    }
+    return failed;
+}
+#endif
@@ -0,0 +1,726 @@
+// Offline benchmarks for the bot internals, build with:
+//   g++ -std=c++17 -O2 -pthread -o benchmark benchmark.cpp
+// Prints JSON: simulator throughput, plus ns/op and allocations/op of the grid algorithms on each fixture.
+// Fails if apply/undo disagrees with the scalar simulator, if the simulator breaks a referee rule or its hash,
+// if the distance table or the heatmap disagree with a brute force count, or if the submission built from
+// hypersonic.cpp no longer fits CodinGame's limit.
+#define HYPERSONIC_NO_MAIN
+#define HYPERSONIC_LOG_LEVEL 0
+#define HYPERSONIC_TRACK_ALLOCATIONS 1
+#include "hypersonic.cpp"
+#include "undo_log.h"
+#define SUBMISSION_NO_MAIN
+#include "submission.cpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+// A board as the referee sends it, seen by player 0
+struct Fixture
+{
+    const char* name;
+    const char* rows[field_height];
+    vector<array<int, 6>> entities; // type, owner, x, y, param1, param2
+};
+
+const Fixture fixtures[] = {
+    { "opening", {
+        ".............",
+        ".X0X.X.X.X0X.",
+        "..0...1...0..",
+        ".X.X2X.X2X.X.",
+        ".0.........0.",
+        ".X.X.X.X.X.X.",
+        ".0.........0.",
+        ".X.X2X.X2X.X.",
+        "..0...1...0..",
+        ".X0X.X.X.X0X.",
+        "............." },
+      { {0, 0, 0, 0, 1, 3}, {0, 1, 12, 10, 1, 3}, {0, 2, 12, 0, 1, 3}, {0, 3, 0, 10, 1, 3} } },
+    { "dense", {
+        "...0.....0...",
+        ".X0X.X1X.X0X.",
+        "0.0.1...1.0.0",
+        ".X.X2X.X2X.X.",
+        "00.........00",
+        ".X0X.X.X.X0X.",
+        "00.........00",
+        ".X.X2X.X2X.X.",
+        "0.0.1...1.0.0",
+        ".X0X.X1X.X0X.",
+        "...0.....0..." },
+      { {0, 0, 4, 4, 0, 4}, {0, 1, 8, 6, 0, 3}, {0, 2, 8, 4, 1, 3}, {0, 3, 4, 6, 1, 4},
+        {1, 0, 4, 4, 7, 4}, {1, 0, 2, 4, 3, 4}, {1, 1, 8, 6, 8, 3}, {1, 1, 6, 6, 2, 3},
+        {1, 2, 10, 4, 5, 3}, {1, 3, 4, 8, 6, 4}, {1, 3, 6, 4, 1, 4}, {1, 2, 8, 2, 4, 3},
+        {2, 0, 6, 2, 1, 0}, {2, 0, 6, 8, 2, 0}, {2, 0, 2, 6, 1, 0} } },
+    { "sparse", {
+        ".............",
+        ".X.X.X.X.X.X.",
+        ".............",
+        ".X.X.X.X.X.X.",
+        ".0.........0.",
+        ".X.X.X.X.X.X.",
+        ".............",
+        ".X.X.X.X.X.X.",
+        ".............",
+        ".X.X.X.X.X.X.",
+        "............." },
+      { {0, 0, 6, 6, 2, 6}, {0, 1, 10, 2, 1, 5},
+        {1, 1, 10, 2, 5, 5}, {1, 0, 2, 8, 3, 6},
+        {2, 0, 0, 0, 1, 0}, {2, 0, 12, 10, 2, 0} } },
+};
+
+// The fixture as the simulator sees it
+GameState fixture_state( const Fixture& fixture )
+{
+    GameState s;
+    for( int r = 0; r < field_height; r++ )
+    {
+        s.load_row( r, fixture.rows[r] );
+    }
+    for( const array<int, 6>& e: fixture.entities )
+    {
+        const Position p( e[3], e[2] );
+        if( e[0] == Entities::character ) s.add_player( e[1], p, e[4], e[5] );
+        else if( e[0] == Entities::bomb ) s.add_bomb( e[1], p, e[4], e[5] );
+        else s.add_item( p, e[4] );
+    }
+    return s;
+}
+
+}
+
+// Fills the field and character the way Bot does from referee input.
+// Outside the anonymous namespace, Field befriends it to reach the BFS helpers.
+struct FieldBenchmark
+{
+    explicit FieldBenchmark( const Fixture& fixture ): character( field )
+    {
+        GameState state;
+        field.clear();
+        for( int r = 0; r < field_height; r++ )
+        {
+            field.update_rows( fixture.rows[r], field_width );
+            state.load_row( r, fixture.rows[r] );
+        }
+        distances.build( state.board );
+        rays.clip( state.board.walls );
+        field.set_distances( &distances );
+        field.set_blast_rays( &rays );
+
+        for( const array<int, 6>& e: fixture.entities )
+        {
+            const Position p( e[3], e[2] );
+            if( e[0] == Entities::character && e[1] == 0 )
+            {
+                me = p;
+                range = e[5] - 1;
+                character.my_pos = p;
+                character.update_stats( e[4], e[5] );
+                field.set_character_pos( p );
+            }
+            else if( e[0] == Entities::bomb )
+            {
+                field.set_bomb( p, e[5] - 1, e[4] );
+            }
+            else if( e[0] == Entities::item )
+            {
+                if( e[4] == 1 ) field.set_range_upgrade( p );
+                else field.set_count_upgrade( p );
+            }
+        }
+        field.update_bomb_affected_boxes();
+    }
+
+    // Flood over everything walkable, the way the path queries use it
+    int bfs( Field& f )
+    {
+        int visited = 0;
+        f.BFSqueue( me, [&]( const Position& p ){
+            const bool start = visited++ == 0; // we may stand on our own bomb
+            return !start && f.field_.is_obstacle( p ) ? Field::BFSresult::ignore : Field::BFSresult::continue_search;
+        } );
+        return visited;
+    }
+
+    // Every corner and the cells around the middle, from a cell next to ours
+    int has_paths( Field& f )
+    {
+        const Position from( me.row, me.col > 0 ? me.col - 1 : me.col + 1 );
+        const Position targets[6] = { {0, 0}, {0, field_width - 1}, {field_height - 1, 0},
+                                      {field_height - 1, field_width - 1}, {5, 6}, {4, 6} };
+        int reachable = 0;
+        for( const Position& t: targets )
+        {
+            reachable += f.has_path( from, t );
+        }
+        return reachable;
+    }
+
+    // What the heatmap reads, boxes the bombs take out marked doomed
+    const Board& board() const { return field.field_; }
+
+    Field field;
+    Character character;
+    DistanceTable distances;
+    BlastRays rays = grid_rays;
+    Position me = {0, 0};
+    int range = 2;
+};
+
+namespace
+{
+
+struct Measurement
+{
+    double ns_per_op;
+    double allocations_per_op;
+};
+
+// Runs op in growing batches until enough time has passed
+template<class F> Measurement measure( double seconds, F op )
+{
+    long long ops = 0;
+    const long long allocations_before = allocations_made;
+    const auto begin = chrono::steady_clock::now();
+    double elapsed = 0;
+    for( long long batch = 1; elapsed < seconds; batch *= 2 )
+    {
+        for( long long i = 0; i < batch; i++ )
+        {
+            op();
+        }
+        ops += batch;
+        elapsed = chrono::duration<double>( chrono::steady_clock::now() - begin ).count();
+    }
+    return { elapsed * 1e9 / ops, double( allocations_made - allocations_before ) / ops };
+}
+
+// Keeps results alive so the measured calls are not optimised out
+volatile int sink;
+
+// Random walkers that drop bombs now and then, restarting whenever a game ends
+double simulator_steps_per_second( double seconds )
+{
+    const GameState start = fixture_state( fixtures[0] );
+    GameState s = start;
+    Random rng( 12345 );
+    long long steps = 0;
+
+    const auto begin = chrono::steady_clock::now();
+    const auto until = begin + chrono::duration<double>( seconds );
+    while( chrono::steady_clock::now() < until )
+    {
+        for( int batch = 0; batch < 1024; batch++ )
+        {
+            if( s.finished )
+            {
+                s = start;
+            }
+
+            Action actions[GameState::max_players];
+            for( int id = 0; id < GameState::max_players; id++ )
+            {
+                const Position p = cell_position( s.players[id].cell == GameState::nowhere ? 0 : s.players[id].cell );
+                const Position around[5] = { p, {p.row - 1, p.col}, {p.row + 1, p.col}, {p.row, p.col - 1}, {p.row, p.col + 1} };
+                Position to = around[rng.below( 5 )];
+                if( to.row < 0 || to.row >= field_height || to.col < 0 || to.col >= field_width )
+                {
+                    to = p;
+                }
+                actions[id] = rng.below( 8 ) ? Action::move( to ) : Action::bomb( to );
+            }
+            s.step( actions );
+            steps++;
+        }
+    }
+    const double elapsed = chrono::duration<double>( chrono::steady_clock::now() - begin ).count();
+    return steps / elapsed;
+}
+
+}
+
+// Calls that mark the field work on a fresh copy each time, the copy is measured on its own and taken off
+void field_benchmarks( double seconds, vector<string>& results )
+{
+    for( const Fixture& fixture: fixtures )
+    {
+        FieldBenchmark bench( fixture );
+        Field& field = bench.field;
+        const Field pristine = field;
+        Field work = pristine;
+
+        auto record = [&]( const char* name, Measurement m ){
+            char line[256];
+            snprintf( line, sizeof line, "{\"fixture\": \"%s\", \"name\": \"%s\", \"ns_per_op\": %.1f, \"allocations_per_op\": %.2f}",
+                      fixture.name, name, m.ns_per_op, m.allocations_per_op );
+            results.push_back( line );
+        };
+        auto on_copy = [&]( Measurement m, const Measurement& copy ){
+            return Measurement{ max( 0.0, m.ns_per_op - copy.ns_per_op ), m.allocations_per_op - copy.allocations_per_op };
+        };
+
+        const Measurement copy = measure( seconds, [&]{ work = pristine; } );
+        record( "field_copy", copy );
+        record( "bfs", measure( seconds, [&]{ sink = bench.bfs( field ); } ) );
+        record( "has_path", measure( seconds, [&]{ sink = bench.has_paths( field ); } ) );
+        record( "get_closest_boxes_from", on_copy( measure( seconds, [&]{
+            work = pristine;
+            sink = work.get_closest_boxes_from( bench.me, bench.range ).count;
+        } ), copy ) );
+        record( "safe_to_bomb", measure( seconds, [&]{ sink = field.safe_to_bomb( bench.me, bench.range ); } ) );
+        record( "update_bomb_affected_boxes", measure( seconds, [&]{ field.update_bomb_affected_boxes(); } ) );
+        record( "bomb_and_move", on_copy( measure( seconds, [&]{
+            work = pristine;
+            Character character( work );
+            character.my_pos = bench.me;
+            character.update_stats( 1, bench.range + 1 );
+            sink = (int)character.bomb_and_move().size();
+        } ), copy ) );
+        record( "best_place_to_bomb", on_copy( measure( seconds, [&]{
+            work = pristine;
+            sink = work.best_place_to_bomb( bench.range ).col;
+        } ), copy ) );
+
+        // a new reach sweeps every line, the same board again none of them
+        BombHeatmap heatmap;
+        const CharacterParams& params = default_character_params;
+        int reach = bench.range;
+        record( "heatmap_update", measure( seconds, [&]{
+            reach = reach == bench.range ? bench.range + 1 : bench.range;
+            heatmap.update( bench.board(), reach, params.box_value, params.item_box_value );
+            sink = heatmap.at( bench.me );
+        } ) );
+        record( "heatmap_update_unchanged", measure( seconds, [&]{
+            heatmap.update( bench.board(), reach, params.box_value, params.item_box_value );
+            sink = heatmap.at( bench.me );
+        } ) );
+    }
+}
+
+// A search-length playout from the opening, started from a root copy or played in place and taken back
+void playout_benchmarks( double seconds, vector<string>& results )
+{
+    const GameState root = fixture_state( fixtures[0] );
+    static UndoLog log;
+    GameState work = root;
+    Random rng( 99 );
+
+    auto random_actions = [&]( const GameState& s, Action actions[GameState::max_players] ){
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            const Position p = cell_position( s.players[id].cell == GameState::nowhere ? 0 : s.players[id].cell );
+            Position to = Search::step_position( p, rng.below( 5 ) );
+            if( to.row < 0 || to.row >= field_height || to.col < 0 || to.col >= field_width ) to = p;
+            actions[id] = rng.below( 6 ) ? Action::move( to ) : Action::bomb( to );
+        }
+    };
+
+    auto record = [&]( const char* name, Measurement m ){
+        char line[256];
+        snprintf( line, sizeof line, "{\"fixture\": \"opening\", \"name\": \"%s\", \"ns_per_op\": %.1f, \"allocations_per_op\": %.2f}",
+                  name, m.ns_per_op, m.allocations_per_op );
+        results.push_back( line );
+    };
+
+    record( "playout_copy", measure( seconds, [&]{
+        GameState s = root;
+        for( int d = 0; d < Search::horizon; d++ )
+        {
+            Action actions[GameState::max_players];
+            random_actions( s, actions );
+            s.step( actions );
+        }
+        sink = (int)s.hash;
+    } ) );
+    record( "playout_apply_undo", measure( seconds, [&]{
+        for( int d = 0; d < Search::horizon; d++ )
+        {
+            Action actions[GameState::max_players];
+            random_actions( work, actions );
+            apply( work, actions, log );
+        }
+        sink = (int)work.hash;
+        while( log.depth ) undo( work, log );
+    } ) );
+}
+
+// Everything the referee rules read or write, the derived planes and the hash included
+bool same_state( const GameState& a, const GameState& b )
+{
+    const Bitboard Board::* planes[] = { &Board::walls, &Board::boxes, &Board::range_boxes, &Board::count_boxes,
+        &Board::range_items, &Board::count_items, &Board::bombs, &Board::blast, &Board::danger, &Board::doomed };
+    for( const Bitboard Board::* plane: planes )
+    {
+        if( a.board.*plane != b.board.*plane ) return false;
+    }
+    for( int id = 0; id < GameState::max_players; id++ )
+    {
+        const GameState::Player& p = a.players[id];
+        const GameState::Player& q = b.players[id];
+        if( p.cell != q.cell || p.bombs != q.bombs || p.range != q.range || p.boxes != q.boxes ||
+            p.alive != q.alive || p.eliminated_turn != q.eliminated_turn ) return false;
+    }
+    return !memcmp( a.bomb_timer, b.bomb_timer, field_cells ) && !memcmp( a.bomb_owner, b.bomb_owner, field_cells ) &&
+           !memcmp( a.bomb_range, b.bomb_range, field_cells ) && a.turn == b.turn && a.stale_turns == b.stale_turns &&
+           a.no_box_turns == b.no_box_turns && a.participants == b.participants && a.finished == b.finished && a.hash == b.hash;
+}
+
+// Random legal actions for every player, bombs one time in six
+void random_legal_actions( const GameState& s, Random& rng, Action actions[GameState::max_players] )
+{
+    for( int id = 0; id < GameState::max_players; id++ )
+    {
+        const GameState::Player& player = s.players[id];
+        int a = 0;
+        for( int attempt = 0; player.alive && attempt < 8; attempt++ )
+        {
+            const int candidate = rng.below( 5 ) + ( rng.below( 6 ) ? 0 : 5 );
+            if( Search::legal( s, id, candidate ) )
+            {
+                a = candidate;
+                break;
+            }
+        }
+        actions[id] = Search::to_action( cell_position( player.alive ? player.cell : 0 ), a );
+    }
+}
+
+// Lines of apply() from every fixture, each turn checked against step() on a copy, then taken back with
+// undo() and checked against the state it started from. Returns the number of turns that differ.
+int apply_undo_mismatches( int lines )
+{
+    static UndoLog log;
+    Random rng( 31 );
+    int mismatches = 0;
+    for( int line = 0; line < lines; line++ )
+    {
+        GameState work = fixture_state( fixtures[line % ( sizeof fixtures / sizeof fixtures[0] )] );
+        GameState before[UndoLog::capacity];
+        log.clear();
+        while( !work.finished && log.depth < UndoLog::capacity )
+        {
+            Action actions[GameState::max_players];
+            random_legal_actions( work, rng, actions );
+            before[log.depth] = work;
+            GameState expected = work;
+            expected.step( actions );
+            apply( work, actions, log );
+            mismatches += !same_state( work, expected );
+        }
+        while( log.depth )
+        {
+            undo( work, log );
+            mismatches += !same_state( work, before[log.depth] );
+        }
+    }
+    return mismatches;
+}
+
+// Random legal games from every fixture, the incremental hash checked against compute_hash() after each
+// turn. Returns the number of turns where they differ.
+int hash_mismatches( int games )
+{
+    Random rng( 47 );
+    int mismatches = 0;
+    for( int g = 0; g < games; g++ )
+    {
+        GameState s = fixture_state( fixtures[g % ( sizeof fixtures / sizeof fixtures[0] )] );
+        mismatches += s.hash != s.compute_hash();
+        while( !s.finished )
+        {
+            Action actions[GameState::max_players];
+            random_legal_actions( s, rng, actions );
+            s.step( actions );
+            mismatches += s.hash != s.compute_hash();
+        }
+    }
+    return mismatches;
+}
+
+// Cells where two tables disagree on a distance or a next hop
+int table_differences( const DistanceTable& a, const DistanceTable& b )
+{
+    int differences = 0;
+    for( int to = 0; to < field_cells; to++ )
+    {
+        for( int from = 0; from < field_cells; from++ )
+        {
+            differences += a.distance( from, to ) != b.distance( from, to ) || a.next_hop( from, to ) != b.next_hop( from, to );
+        }
+    }
+    return differences;
+}
+
+// The distance table against plain BFS on every fixture: distances, next hops and the referee's MOVE step.
+// Then random games patch a table as boxes go and compare it with one rebuilt from the board.
+// Returns the number of entries that differ.
+int distance_table_mismatches( int games )
+{
+    static DistanceTable table, rebuilt;
+    Random rng( 53 );
+    int mismatches = 0;
+    for( const Fixture& fixture: fixtures )
+    {
+        GameState s = fixture_state( fixture );
+        table.build( s.board );
+        const Bitboard blocked = s.board.walls | s.board.boxes;
+        for( int to = 0; to < field_cells; to++ )
+        {
+            uint8_t distance[field_cells];
+            if( blocked.test( to ) ) fill( distance, distance + field_cells, DistanceTable::unreachable );
+            else walk_distances( to, blocked, distance );
+            for( int from = 0; from < field_cells; from++ )
+            {
+                mismatches += table.distance( from, to ) != distance[from];
+                mismatches += !blocked.test( to ) && table.next_hop( from, to ) != first_step( from, distance );
+                // the simulator walks by BFS without a table
+                mismatches += !blocked.test( from ) && table.step( from, to ) != s.next_step( (uint8_t)from, (uint8_t)to, blocked );
+            }
+        }
+    }
+
+    for( int g = 0; g < games; g++ )
+    {
+        GameState s = fixture_state( fixtures[g % ( sizeof fixtures / sizeof fixtures[0] )] );
+        table.build( s.board );
+        while( !s.finished )
+        {
+            const Bitboard boxes = s.board.boxes;
+            Action actions[GameState::max_players];
+            random_legal_actions( s, rng, actions );
+            s.step( actions );
+            if( boxes != s.board.boxes )
+            {
+                table.remove_boxes( boxes.without( s.board.boxes ) );
+                rebuilt.build( s.board );
+                mismatches += table_differences( table, rebuilt ) + ( table.blocked() != rebuilt.blocked() );
+            }
+        }
+    }
+    return mismatches;
+}
+
+// The incremental heatmap against walking every blast from scratch. Random games from every fixture doom
+// a random part of the boxes and items and now and then change the reach or the box weights.
+// Returns the number of cells that differ.
+int heatmap_mismatches( int games )
+{
+    Random rng( 59 );
+    int mismatches = 0;
+    for( int g = 0; g < games; g++ )
+    {
+        GameState s = fixture_state( fixtures[g % ( sizeof fixtures / sizeof fixtures[0] )] );
+        BombHeatmap heatmap;
+        int reach = 2, box_value = default_character_params.box_value, item_box_value = default_character_params.item_box_value;
+        while( !s.finished )
+        {
+            if( !rng.below( 16 ) ) reach = 1 + rng.below( 8 );
+            if( !rng.below( 16 ) ) box_value = rng.below( 16 ), item_box_value = rng.below( 16 );
+
+            Board board = s.board;
+            ( board.boxes | board.items() ).for_each( [&]( int i ){ if( !rng.below( 4 ) ) board.doomed.set( i ); } );
+            heatmap.update( board, reach, box_value, item_box_value );
+
+            const Bitboard blockers = board.walls | board.boxes | board.items() | board.doomed;
+            const Bitboard live_boxes = board.boxes.without( board.doomed );
+            for( int i = 0; i < field_cells; i++ )
+            {
+                int value = 0;
+                if( !( board.walls | board.boxes ).test( i ) )
+                {
+                    walk_blast( grid_rays, i, reach, [&]( int c ){
+                        if( live_boxes.test( c ) ) value += ( board.range_boxes | board.count_boxes ).test( c ) ? item_box_value : box_value;
+                        return blockers.test( c );
+                    } );
+                }
+                mismatches += heatmap.at( i ) != value;
+            }
+
+            Action actions[GameState::max_players];
+            random_legal_actions( s, rng, actions );
+            s.step( actions );
+        }
+    }
+    return mismatches;
+}
+
+// Hand-set positions for the referee rules the simulator has to get right: chain reactions, items that
+// appear after the blasts, shared box credit, pickups and the 20-turn ends. Prints and counts the rules broken.
+int rule_failures()
+{
+    int failures = 0;
+    auto expect = [&]( bool ok, const char* rule ){
+        if( !ok ) cerr << "rules: " << rule << endl;
+        failures += !ok;
+    };
+    auto stay = []( const GameState& s, Action actions[GameState::max_players] ){
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            actions[id] = Action::move( cell_position( s.players[id].alive ? s.players[id].cell : 0 ) );
+        }
+    };
+    Action actions[GameState::max_players];
+
+    // A sets off B, B and C both reach the range box, player 3 stands in A's blast
+    {
+        GameState s;
+        s.load_row( 0, "0.....1......" );
+        s.add_bomb( 0, {0, 2}, 1, 3 );
+        s.add_bomb( 1, {0, 4}, 5, 3 );
+        s.add_bomb( 2, {2, 6}, 1, 3 );
+        s.add_item( {2, 5}, 2 );
+        s.add_player( 0, {10, 0}, 0, 3 );
+        s.add_player( 1, {10, 12}, 0, 3 );
+        s.add_player( 2, {5, 0}, 0, 3 );
+        s.add_player( 3, {0, 1}, 1, 3 );
+        stay( s, actions );
+        s.step( actions );
+        expect( !s.board.bombs.any(), "a blast sets off the bombs it reaches" );
+        expect( !s.board.boxes.any(), "blasts destroy the boxes they reach, chained ones included" );
+        expect( s.board.range_items == Bitboard::of( {0, 6} ), "a destroyed box drops its item after the blasts" );
+        expect( !s.board.count_items.any(), "blasts destroy the items they reach" );
+        expect( s.players[0].boxes == 1 && s.players[1].boxes == 1 && s.players[2].boxes == 1,
+                "every owner whose blast reaches a box gets the credit" );
+        expect( s.players[0].bombs == 1 && s.players[1].bombs == 1 && s.players[2].bombs == 1, "exploded bombs go back to their owners" );
+        expect( !s.players[3].alive && s.players[3].eliminated_turn == 0 && !s.finished, "blasts eliminate the players they reach" );
+    }
+
+    // 0 and 1 reach the range item together, 2 walks onto a bomb item
+    {
+        GameState s;
+        s.load_row( 8, "0............" );
+        s.add_item( {4, 4}, 1 );
+        s.add_item( {6, 5}, 2 );
+        s.add_player( 0, {4, 3}, 1, 3 );
+        s.add_player( 1, {4, 5}, 1, 3 );
+        s.add_player( 2, {6, 4}, 1, 3 );
+        stay( s, actions );
+        actions[0] = actions[1] = Action::move( {4, 4} );
+        actions[2] = Action::move( {6, 5} );
+        s.step( actions );
+        expect( s.players[0].range == 4 && s.players[1].range == 4, "players arriving together all pick the item up" );
+        expect( s.players[2].bombs == 2, "a bomb item gives one more bomb" );
+        expect( !s.board.items().any(), "picked items are gone" );
+    }
+
+    // no box left: 0 keeps walking so the state is never stale, the game stops 20 turns on
+    {
+        GameState s;
+        s.add_player( 0, {0, 0}, 1, 3 );
+        s.add_player( 1, {10, 12}, 1, 3 );
+        for( int t = 0; t < 20; t++ )
+        {
+            expect( !s.finished, "the game goes on until 20 turns without a box" );
+            stay( s, actions );
+            actions[0] = Action::move( t % 2 ? Position( 0, 0 ) : Position( 0, 1 ) );
+            s.step( actions );
+        }
+        expect( s.finished && s.players[0].alive && s.players[1].alive, "the game stops 20 turns after the last box" );
+    }
+
+    // boxes left but nothing changes, the game stops after 20 identical turns
+    {
+        GameState s;
+        s.load_row( 5, "......0......" );
+        s.add_player( 0, {0, 0}, 1, 3 );
+        s.add_player( 1, {10, 12}, 1, 3 );
+        for( int t = 0; t < 20; t++ )
+        {
+            expect( !s.finished, "the game goes on until 20 identical turns" );
+            stay( s, actions );
+            s.step( actions );
+        }
+        expect( s.finished, "the game stops after 20 identical turns" );
+    }
+    return failures;
+}
+
+int main( int argc, char** argv )
+{
+    // minimum acceptable simulator throughput, search needs hundreds of thousands of steps per turn
+    double min_steps_per_second = 2e6;
+    double seconds = 1.0;
+    double field_seconds = 0.05;
+    // the bot's source next to this file unless given
+    string source = __FILE__;
+    source = source.substr( 0, source.find_last_of( '/' ) + 1 ) + "hypersonic.cpp";
+    for( int i = 1; i + 1 < argc; i += 2 )
+    {
+        if( !strcmp( argv[i], "--min-steps" ) ) min_steps_per_second = atof( argv[i + 1] );
+        else if( !strcmp( argv[i], "--seconds" ) ) seconds = atof( argv[i + 1] );
+        else if( !strcmp( argv[i], "--field-seconds" ) ) field_seconds = atof( argv[i + 1] );
+        else if( !strcmp( argv[i], "--source" ) ) source = argv[i + 1];
+    }
+
+    string submission_source, submission_error;
+    if( !submission::build( source, "", submission_source, submission_error ) )
+    {
+        cerr << "submission: " << submission_error << endl;
+        return 1;
+    }
+
+    const double steps_per_second = simulator_steps_per_second( seconds );
+    vector<string> results;
+    field_benchmarks( field_seconds, results );
+    playout_benchmarks( field_seconds, results );
+    const int undo_mismatches = apply_undo_mismatches( 300 );
+    const int rules_broken = rule_failures();
+    const int hash_errors = hash_mismatches( 300 );
+    const int table_errors = distance_table_mismatches( 30 );
+    const int heatmap_errors = heatmap_mismatches( 60 );
+
+    cout << "{\n  \"simulator_steps_per_sec\": " << (long long)steps_per_second << ",\n";
+    cout << "  \"apply_undo_mismatches\": " << undo_mismatches << ",\n";
+    cout << "  \"rule_failures\": " << rules_broken << ",\n";
+    cout << "  \"hash_mismatches\": " << hash_errors << ",\n";
+    cout << "  \"distance_table_mismatches\": " << table_errors << ",\n";
+    cout << "  \"heatmap_mismatches\": " << heatmap_errors << ",\n";
+    cout << "  \"submission_chars\": " << submission_source.size() << ",\n  \"benchmarks\": [\n";
+    for( size_t r = 0; r < results.size(); r++ )
+    {
+        cout << "    " << results[r] << ( r + 1 < results.size() ? ",\n" : "\n" );
+    }
+    cout << "  ]\n}" << endl;
+
+    if( undo_mismatches )
+    {
+        cerr << "apply/undo: " << undo_mismatches << " turns differ from GameState::step or the state before" << endl;
+        return 1;
+    }
+    if( rules_broken )
+    {
+        cerr << "rules: " << rules_broken << " referee rules broken by GameState::step" << endl;
+        return 1;
+    }
+    if( hash_errors )
+    {
+        cerr << "hash: " << hash_errors << " turns where the incremental hash differs from compute_hash()" << endl;
+        return 1;
+    }
+    if( table_errors )
+    {
+        cerr << "distance table: " << table_errors << " entries differ from BFS or from a rebuilt table" << endl;
+        return 1;
+    }
+    if( heatmap_errors )
+    {
+        cerr << "heatmap: " << heatmap_errors << " cells differ from walking the blasts" << endl;
+        return 1;
+    }
+    if( submission_source.size() > submission::max_chars )
+    {
+        cerr << "submission: " << submission_source.size() << " characters, over CodinGame's " << submission::max_chars << endl;
+        return 1;
+    }
+    if( steps_per_second < min_steps_per_second )
+    {
+        cerr << "simulator: " << (long long)steps_per_second << " steps/sec, below target " << (long long)min_steps_per_second << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -1,12 +1,252 @@
 #include <iostream>
 #include <string>
 #include <vector>
-#include <queue>
+#include <array>
 #include <algorithm>
-#include <functional>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <charconv>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
 
 using namespace std;
 
+// Log levels, anything above HYPERSONIC_LOG_LEVEL is compiled out
+#ifndef HYPERSONIC_LOG_LEVEL
+#define HYPERSONIC_LOG_LEVEL 2
+#endif
+
+enum LogLevel
+{
+    log_off = 0,
+    log_error = 1,
+    log_info = 2,
+    log_debug = 3
+};
+
+// Collects the turn's log lines and writes them out in one go
+struct Log
+{
+    static Log& get()
+    {
+        static Log instance;
+        return instance;
+    }
+
+    Log& operator<<( const char* s )
+    {
+        text_ += s;
+        return *this;
+    }
+    Log& operator<<( const string& s )
+    {
+        text_ += s;
+        return *this;
+    }
+    Log& operator<<( char c )
+    {
+        text_ += c;
+        return *this;
+    }
+    Log& operator<<( long long v )
+    {
+        char digits[24];
+        text_.append( digits, to_chars( digits, digits + sizeof digits, v ).ptr );
+        return *this;
+    }
+    Log& operator<<( int v )
+    {
+        return *this << (long long)v;
+    }
+
+    void flush()
+    {
+        if( text_.empty() ) return;
+        fwrite( text_.data(), 1, text_.size(), stderr );
+        text_.clear();
+    }
+
+private:
+    Log()
+    {
+        text_.reserve( 1 << 12 );
+    }
+    string text_;
+};
+
+#define LOG( level, message ) \
+    do { if constexpr( (level) <= HYPERSONIC_LOG_LEVEL ) { Log::get() << message << '\n'; } } while( 0 )
+
+// Scoped timers and counters for the hot paths, in profile.h and compiled out unless HYPERSONIC_PROFILE is 1
+#ifndef HYPERSONIC_PROFILE
+#define HYPERSONIC_PROFILE 0
+#endif
+
+#if HYPERSONIC_PROFILE
+#include "profile.h"
+#else
+#define PROFILE_SCOPE( probe ) do {} while( 0 )
+#define PROFILE_COUNT( counter, n ) do {} while( 0 )
+#endif
+
+// Heap allocations made by this thread, counted only when HYPERSONIC_TRACK_ALLOCATIONS is 1.
+// Once the first turns have warmed everything up a turn is expected not to allocate at all.
+#ifndef HYPERSONIC_TRACK_ALLOCATIONS
+#define HYPERSONIC_TRACK_ALLOCATIONS 0
+#endif
+
+inline thread_local long long allocations_made = 0;
+
+#if HYPERSONIC_TRACK_ALLOCATIONS
+// Kept out of line: inlined, GCC pairs malloc() and free() with the operators around them and warns
+[[gnu::noinline]] void* operator new( size_t size )
+{
+    allocations_made++;
+    if( void* p = malloc( size ? size : 1 ) ) return p;
+    throw bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+
+[[gnu::noinline]] void operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
+
+// the array forms too, or new[] and delete[] would pair the library's with ours
+[[gnu::noinline]] void* operator new[]( size_t size )
+{
+    return operator new( size );
+}
+
+[[gnu::noinline]] void operator delete[]( void* p ) noexcept
+{
+    free( p );
+}
+
+[[gnu::noinline]] void operator delete[]( void* p, size_t ) noexcept
+{
+    free( p );
+}
+#endif
+
+// Reads a file descriptor in large chunks and hands out whitespace separated tokens
+// straight from the buffer, no per token allocation
+struct InputReader
+{
+    explicit InputReader( int fd = 0 ): fd_( fd )
+    {}
+
+    // Copies everything read from now on to fd
+    void record( int fd )
+    {
+        record_fd_ = fd;
+    }
+
+    // Points into the buffer, valid until the next call; nullptr once the input is over
+    const char* next_word( int& length )
+    {
+        if( !skip_spaces() ) return nullptr;
+        int n = 0;
+        while( ( begin_ + n < end_ || fill() ) && (unsigned char)buffer_[begin_ + n] > ' ' )
+        {
+            n++;
+        }
+        const char* word = buffer_ + begin_;
+        begin_ += n;
+        length = n;
+        return word;
+    }
+
+    bool next_int( int& value )
+    {
+        int length;
+        const char* word = next_word( length );
+        if( !word ) return false;
+        return from_chars( word, word + length, value ).ec == errc();
+    }
+
+    // Blocks until there is another word to read, without reading it
+    void wait()
+    {
+        while( begin_ < end_ && (unsigned char)buffer_[begin_] <= ' ' )
+        {
+            begin_++;
+        }
+        if( begin_ < end_ ) return;
+        pollfd ready = { fd_, POLLIN, 0 };
+        while( poll( &ready, 1, -1 ) < 0 && errno == EINTR )
+        {}
+    }
+
+private:
+    bool skip_spaces()
+    {
+        for( ;; )
+        {
+            if( begin_ == end_ && !fill() ) return false;
+            if( (unsigned char)buffer_[begin_] > ' ' ) return true;
+            begin_++;
+        }
+    }
+
+    // Keeps the unread tail at the front and appends whatever the descriptor has
+    bool fill()
+    {
+        if( begin_ > 0 )
+        {
+            memmove( buffer_, buffer_ + begin_, end_ - begin_ );
+            end_ -= begin_;
+            begin_ = 0;
+        }
+        if( end_ == (int)sizeof buffer_ ) return false;
+        for( ;; )
+        {
+            const ssize_t got = read( fd_, buffer_ + end_, sizeof buffer_ - end_ );
+            if( got > 0 )
+            {
+                if( record_fd_ >= 0 ) save( buffer_ + end_, (int)got );
+                end_ += (int)got;
+                return true;
+            }
+            if( got == 0 || errno != EINTR ) return false;
+        }
+    }
+
+    void save( const char* data, int length )
+    {
+        while( length > 0 )
+        {
+            const ssize_t put = write( record_fd_, data, length );
+            if( put < 0 && errno == EINTR ) continue;
+            if( put <= 0 ) break;
+            data += put;
+            length -= (int)put;
+        }
+    }
+
+    int fd_;
+    int record_fd_ = -1;
+    int begin_ = 0;
+    int end_ = 0;
+    char buffer_[1 << 16];
+};
+
 struct Position
 {
     Position(int r, int c): row(r), col(c)
@@ -17,651 +257,3641 @@ struct Position
         return other.row == row && other.col == col;
     }
 
-    bool operator!=(Position const& other) const
+    bool operator!=(Position const& other) const
+    {
+        return !(*this == other);
+    }
+
+    int row;
+    int col;
+};
+
+// Hypersonic is always played on a 13x11 grid
+constexpr int field_width = 13;
+constexpr int field_height = 11;
+constexpr int field_cells = field_width * field_height;
+
+inline int cell_index( const Position& p )
+{
+    return p.row * field_width + p.col;
+}
+
+inline Position cell_position( int index )
+{
+    return Position( index / field_width, index % field_width );
+}
+
+// Cells next to each cell, in up, left, down, right order, built at compile time
+struct Neighbours
+{
+    uint8_t count = 0;
+    uint8_t cells[4] = {};
+};
+
+constexpr array<Neighbours, field_cells> make_neighbours()
+{
+    array<Neighbours, field_cells> table{};
+    for( int i = 0; i < field_cells; i++ )
+    {
+        const int r = i / field_width, c = i % field_width;
+        Neighbours& n = table[i];
+        if( r > 0 ) n.cells[n.count++] = (uint8_t)( i - field_width );
+        if( c > 0 ) n.cells[n.count++] = (uint8_t)( i - 1 );
+        if( r < field_height - 1 ) n.cells[n.count++] = (uint8_t)( i + field_width );
+        if( c < field_width - 1 ) n.cells[n.count++] = (uint8_t)( i + 1 );
+    }
+    return table;
+}
+
+constexpr array<Neighbours, field_cells> neighbours_of = make_neighbours();
+
+// Breadth first search result: steps from the origin and where each cell was reached from
+struct PathMap
+{
+    static constexpr uint8_t unreachable = 0xFF;
+
+    uint8_t distance[field_cells];
+    uint8_t parent[field_cells];
+
+    bool reachable( int i ) const { return distance[i] != unreachable; }
+};
+
+// One bit per cell, row-major. 143 cells fit in three words, the spare high bits always stay zero.
+struct Bitboard
+{
+    uint64_t bits[3] = {0, 0, 0};
+
+    constexpr bool test( int i ) const { return ( bits[i >> 6] >> ( i & 63 ) ) & 1; }
+    constexpr void set( int i ) { bits[i >> 6] |= uint64_t(1) << ( i & 63 ); }
+    constexpr void reset( int i ) { bits[i >> 6] &= ~( uint64_t(1) << ( i & 63 ) ); }
+
+    bool test( const Position& p ) const { return test( cell_index( p ) ); }
+    void set( const Position& p ) { set( cell_index( p ) ); }
+    void reset( const Position& p ) { reset( cell_index( p ) ); }
+
+    constexpr bool any() const { return ( bits[0] | bits[1] | bits[2] ) != 0; }
+    int count() const { return __builtin_popcountll( bits[0] ) + __builtin_popcountll( bits[1] ) + __builtin_popcountll( bits[2] ); }
+
+    constexpr Bitboard operator|( const Bitboard& o ) const { return {{ bits[0] | o.bits[0], bits[1] | o.bits[1], bits[2] | o.bits[2] }}; }
+    constexpr Bitboard operator&( const Bitboard& o ) const { return {{ bits[0] & o.bits[0], bits[1] & o.bits[1], bits[2] & o.bits[2] }}; }
+    constexpr Bitboard operator^( const Bitboard& o ) const { return {{ bits[0] ^ o.bits[0], bits[1] ^ o.bits[1], bits[2] ^ o.bits[2] }}; }
+    constexpr Bitboard without( const Bitboard& o ) const { return {{ bits[0] & ~o.bits[0], bits[1] & ~o.bits[1], bits[2] & ~o.bits[2] }}; }
+    Bitboard& operator|=( const Bitboard& o ) { return *this = *this | o; }
+    Bitboard& operator&=( const Bitboard& o ) { return *this = *this & o; }
+    constexpr bool operator==( const Bitboard& o ) const { return bits[0] == o.bits[0] && bits[1] == o.bits[1] && bits[2] == o.bits[2]; }
+    constexpr bool operator!=( const Bitboard& o ) const { return !( *this == o ); }
+
+    // shift every cell one step in a direction, cells pushed off the board are dropped
+    Bitboard north() const;
+    Bitboard south() const;
+    Bitboard west() const;
+    Bitboard east() const;
+    Bitboard neighbours() const { return north() | south() | west() | east(); }
+    Bitboard operator~() const;
+
+    template<class F> void for_each( F f ) const
+    {
+        for( int w = 0; w < 3; w++ )
+        {
+            for( uint64_t b = bits[w]; b; b &= b - 1 )
+            {
+                f( w * 64 + __builtin_ctzll( b ) );
+            }
+        }
+    }
+
+    static Bitboard of( const Position& p )
+    {
+        Bitboard b;
+        b.set( p );
+        return b;
+    }
+
+    // towards lower indices
+    constexpr Bitboard shifted_down( int n ) const
+    {
+        return {{ bits[0] >> n | bits[1] << ( 64 - n ), bits[1] >> n | bits[2] << ( 64 - n ), bits[2] >> n }};
+    }
+
+    // towards higher indices, may spill past the last cell
+    constexpr Bitboard shifted_up( int n ) const
+    {
+        return {{ bits[0] << n, bits[1] << n | bits[0] >> ( 64 - n ), bits[2] << n | bits[1] >> ( 64 - n ) }};
+    }
+};
+
+constexpr Bitboard make_column_bits( int col )
+{
+    Bitboard b;
+    for( int r = 0; r < field_height; r++ )
+    {
+        b.set( r * field_width + col );
+    }
+    return b;
+}
+
+constexpr Bitboard make_all_bits()
+{
+    Bitboard b;
+    for( int i = 0; i < field_cells; i++ )
+    {
+        b.set( i );
+    }
+    return b;
+}
+
+constexpr Bitboard all_cells_bits = make_all_bits();
+constexpr Bitboard first_column_bits = make_column_bits( 0 );
+constexpr Bitboard last_column_bits = make_column_bits( field_width - 1 );
+
+inline Bitboard Bitboard::north() const { return shifted_down( field_width ); }
+inline Bitboard Bitboard::south() const { return shifted_up( field_width ) & all_cells_bits; }
+inline Bitboard Bitboard::west() const { return shifted_down( 1 ).without( last_column_bits ); }
+inline Bitboard Bitboard::east() const { return ( shifted_up( 1 ) & all_cells_bits ).without( first_column_bits ); }
+inline Bitboard Bitboard::operator~() const { return all_cells_bits.without( *this ); }
+
+// Cells a blast crosses from each cell, nearest first, in up, left, down, right order.
+// A blast of reach r takes the first r cells of each ray, built at compile time for every reach.
+constexpr int max_reach = field_width - 1;
+
+struct BlastRays
+{
+    uint8_t length[field_cells][4] = {};             // cells up to the grid edge, or up to the first wall once clipped
+    uint8_t cells[field_cells][4][max_reach] = {};
+
+    // Walls never change, so rays are cut in front of them once per game
+    void clip( const Bitboard& walls )
+    {
+        for( int i = 0; i < field_cells; i++ )
+        {
+            for( int d = 0; d < 4; d++ )
+            {
+                int n = 0;
+                while( n < length[i][d] && !walls.test( cells[i][d][n] ) ) n++;
+                length[i][d] = (uint8_t)n;
+            }
+        }
+    }
+};
+
+constexpr BlastRays make_blast_rays()
+{
+    BlastRays rays{};
+    const int dr[4] = { -1, 0, 1, 0 };
+    const int dc[4] = { 0, -1, 0, 1 };
+    for( int i = 0; i < field_cells; i++ )
+    {
+        for( int d = 0; d < 4; d++ )
+        {
+            int r = i / field_width + dr[d], c = i % field_width + dc[d], n = 0;
+            while( r >= 0 && r < field_height && c >= 0 && c < field_width && n < max_reach )
+            {
+                rays.cells[i][d][n++] = (uint8_t)( r * field_width + c );
+                r += dr[d];
+                c += dc[d];
+            }
+            rays.length[i][d] = (uint8_t)n;
+        }
+    }
+    return rays;
+}
+
+constexpr BlastRays grid_rays = make_blast_rays();
+
+// The one blast walking kernel: hit(i) is called for each cell the blast reaches, nearest first,
+// and returns true where the blast stops (walls, boxes, items, bombs)
+template<class F> inline void walk_blast( const BlastRays& rays, int cell, int reach, F hit )
+{
+    for( int d = 0; d < 4; d++ )
+    {
+        const int n = min( reach, (int)rays.length[cell][d] );
+        const uint8_t* ray = rays.cells[cell][d];
+        for( int k = 0; k < n && !hit( ray[k] ); k++ ) {}
+    }
+}
+
+// Plane based field state, fixed size and trivially copyable
+struct Board
+{
+    Bitboard walls;
+    Bitboard boxes;        // every box, including the doomed ones
+    Bitboard range_boxes;  // boxes hiding a range upgrade
+    Bitboard count_boxes;  // boxes hiding a bomb count upgrade
+    Bitboard range_items;
+    Bitboard count_items;
+    Bitboard bombs;
+    Bitboard blast;        // will be hit by a bomb later on
+    Bitboard danger;       // will be hit by a bomb soon
+    Bitboard doomed;       // boxes and items that some bomb is going to destroy
+
+    Bitboard items() const { return range_items | count_items; }
+    Bitboard obstacles() const { return walls | boxes | bombs; }
+
+    bool is_box( const Position& p ) const { return boxes.without( doomed ).test( p ); } // excluding blasted boxes
+    bool is_item( const Position& p ) const { return items().without( doomed ).test( p ); }
+    bool is_obstacle( const Position& p ) const { return obstacles().test( p ); }
+};
+
+// When each cell is going to explode, with chain reactions resolved, plus what can be walked on meanwhile.
+// Step t means the t-th referee turn from now; explosions of a step happen before anybody moves.
+struct DangerMap
+{
+    static constexpr int horizon = 10; // a fresh bomb goes off on step 8
+
+    Bitboard blasts[horizon + 1];   // cells hit at the start of step t
+    Bitboard later[horizon + 1];    // cells hit at some step after t
+    Bitboard blocked[horizon + 1];  // cells that can't be entered on step t: walls and the boxes and bombs still standing
+    uint8_t detonation[field_cells]; // earliest step a cell is hit, 0 when never
+
+    // timers and reaches are indexed by cell, reach excludes the bomb cell itself.
+    // An extra bomb with a full timer may be added at extra_cell to try a placement.
+    void compute( const Board& board, const BlastRays& rays, const uint8_t timers[field_cells], const uint8_t reaches[field_cells],
+                  int extra_cell = -1, int extra_reach = 0 )
+    {
+        uint8_t timer[field_cells];
+        uint8_t reach[field_cells];
+        Bitboard bombs = board.bombs;
+        bombs.for_each( [&]( int b ){ timer[b] = timers[b]; reach[b] = reaches[b]; } );
+        if( extra_cell >= 0 && !bombs.test( extra_cell ) )
+        {
+            bombs.set( extra_cell );
+            timer[extra_cell] = 8;
+            reach[extra_cell] = (uint8_t)extra_reach;
+        }
+
+        Bitboard boxes = board.boxes;
+        Bitboard items = board.items();
+        const Bitboard item_boxes = board.range_boxes | board.count_boxes;
+        fill( detonation, detonation + field_cells, 0 );
+        blocked[0] = board.walls | boxes | bombs;
+
+        for( int t = 1; t <= horizon; t++ )
+        {
+            uint8_t queue[field_cells];
+            int head = 0, tail = 0;
+            Bitboard exploding;
+            bombs.for_each( [&]( int b ){
+                if( timer[b] == t )
+                {
+                    exploding.set( b );
+                    queue[tail++] = (uint8_t)b;
+                }
+            } );
+
+            Bitboard hit;
+            while( head < tail )
+            {
+                const int b = queue[head++];
+                hit.set( b );
+                walk_blast( rays, b, reach[b], [&]( int i ){
+                    if( board.walls.test( i ) ) return true;
+                    hit.set( i );
+                    if( boxes.test( i ) || items.test( i ) ) return true;
+                    if( bombs.test( i ) )
+                    {
+                        if( !exploding.test( i ) ) // chained, goes off with this one
+                        {
+                            exploding.set( i );
+                            queue[tail++] = (uint8_t)i;
+                        }
+                        return true;
+                    }
+                    return false;
+                } );
+            }
+
+            blasts[t] = hit;
+            hit.for_each( [&]( int i ){ if( !detonation[i] ) detonation[i] = (uint8_t)t; } );
+
+            // destroyed boxes open the way for later blasts, unless an item pops out of them
+            const Bitboard boxes_hit = hit & boxes;
+            items = items.without( hit ) | ( boxes_hit & item_boxes );
+            boxes = boxes.without( boxes_hit );
+            bombs = bombs.without( exploding );
+            blocked[t] = board.walls | boxes | bombs;
+        }
+
+        later[horizon] = Bitboard();
+        for( int t = horizon - 1; t >= 0; t-- )
+        {
+            later[t] = later[t + 1] | blasts[t + 1];
+        }
+    }
+
+    // Space-time search: walk (or wait) through cells while they are quiet until a cell no blast will ever reach.
+    // Returns the step at which safety is reached and one such cell, -1 when every route ends in a blast.
+    int escape( const Position& from, Position& safe ) const
+    {
+        Bitboard reach = Bitboard::of( from );
+        for( int t = 0; t <= horizon; t++ )
+        {
+            if( t )
+            {
+                const Bitboard alive = reach.without( blasts[t] );
+                reach = alive | alive.neighbours().without( blocked[t] );
+            }
+            const Bitboard safe_cells = reach.without( later[t] );
+            if( safe_cells.any() )
+            {
+                int best_distance = field_cells;
+                safe_cells.for_each( [&]( int i ){
+                    const Position p = cell_position( i );
+                    const int distance = abs( p.row - from.row ) + abs( p.col - from.col );
+                    if( distance < best_distance )
+                    {
+                        best_distance = distance;
+                        safe = p;
+                    }
+                } );
+                return t;
+            }
+            if( !reach.any() )
+            {
+                break;
+            }
+        }
+        return -1;
+    }
+};
+
+// Steps from origin to every cell over the cells not blocked, unreachable ones are left at 0xFF
+inline void walk_distances( int origin, const Bitboard& blocked, uint8_t distance[field_cells] )
+{
+    fill( distance, distance + field_cells, 0xFF );
+    uint8_t queue[field_cells];
+    int head = 0, tail = 0;
+    queue[tail++] = (uint8_t)origin;
+    distance[origin] = 0;
+    while( head < tail )
+    {
+        const int cur = queue[head++];
+        PROFILE_COUNT( counter_bfs_nodes, 1 );
+        const Neighbours& around = neighbours_of[cur];
+        for( int k = 0; k < around.count; k++ )
+        {
+            const int n = around.cells[k];
+            if( distance[n] != 0xFF || blocked.test( n ) ) continue;
+            distance[n] = distance[cur] + 1;
+            queue[tail++] = (uint8_t)n;
+        }
+    }
+}
+
+// Referee MOVE target: the target itself when reachable, otherwise the reachable cell closest to it
+// (then the one with the shorter walk, then the lowest index)
+inline int move_goal( int target, const uint8_t distance_from[field_cells] )
+{
+    if( distance_from[target] != 0xFF )
+    {
+        return target;
+    }
+    const Position t = cell_position( target );
+    int goal = -1, best_manhattan = 0;
+    for( int i = 0; i < field_cells; i++ )
+    {
+        if( distance_from[i] == 0xFF ) continue;
+        const Position p = cell_position( i );
+        const int manhattan = abs( p.row - t.row ) + abs( p.col - t.col );
+        if( goal < 0 || manhattan < best_manhattan || ( manhattan == best_manhattan && distance_from[i] < distance_from[goal] ) )
+        {
+            goal = i;
+            best_manhattan = manhattan;
+        }
+    }
+    return goal;
+}
+
+// First step on a shortest walk: the first neighbour, in up, left, down, right order, one step closer to the goal
+inline int first_step( int from, const uint8_t distance_to_goal[field_cells] )
+{
+    const int d = distance_to_goal[from];
+    if( d == 0 || d == 0xFF )
+    {
+        return from;
+    }
+    const Neighbours& around = neighbours_of[from];
+    for( int k = 0; k < around.count; k++ )
+    {
+        if( distance_to_goal[around.cells[k]] == d - 1 )
+        {
+            return around.cells[k];
+        }
+    }
+    return from;
+}
+
+// All-pairs walking distances and next hops over walls and boxes. Walls never change and boxes only
+// disappear, so the table is built once per game and patched as boxes are destroyed. Bombs are left out.
+struct DistanceTable
+{
+    static constexpr uint8_t unreachable = 0xFF;
+
+    void build( const Board& board )
+    {
+        blocked_ = board.walls | board.boxes;
+        for( int to = 0; to < field_cells; to++ )
+        {
+            solve( to );
+        }
+    }
+
+    // Opens destroyed boxes; only targets in the area the opened cells join are solved again
+    void remove_boxes( const Bitboard& destroyed )
+    {
+        const Bitboard opened = destroyed & blocked_;
+        if( !opened.any() )
+        {
+            return;
+        }
+        blocked_ = blocked_.without( opened );
+
+        Bitboard region = opened;
+        while( true )
+        {
+            const Bitboard grown = region | region.neighbours().without( blocked_ );
+            if( grown == region ) break;
+            region = grown;
+        }
+        region.for_each( [&]( int to ){ solve( to ); } );
+    }
+
+    bool walkable( int i ) const { return !blocked_.test( i ); }
+    int distance( int from, int to ) const { return distance_[to][from]; }
+    int next_hop( int from, int to ) const { return hop_[to][from]; }
+    const Bitboard& blocked() const { return blocked_; }
+
+    // Cell reached after one MOVE towards target, as the referee plays it when no bomb is in the way
+    int step( int from, int target ) const
+    {
+        const int goal = move_goal( target, distance_[from] );
+        return goal < 0 ? from : next_hop( from, goal );
+    }
+
+    // The walk step() takes does not cross any of the given bombs
+    bool clear_route( int from, int target, const Bitboard& bombs ) const
+    {
+        const int goal = move_goal( target, distance_[from] );
+        for( int cur = from; goal >= 0 && cur != goal; )
+        {
+            cur = next_hop( cur, goal );
+            if( bombs.test( cur ) ) return false;
+        }
+        return true;
+    }
+
+private:
+    Bitboard blocked_;
+    uint8_t distance_[field_cells][field_cells]; // [to][from], symmetric
+    uint8_t hop_[field_cells][field_cells];      // [to][from]
+
+    void solve( int to )
+    {
+        uint8_t* distance = distance_[to];
+        if( blocked_.test( to ) )
+        {
+            fill( distance, distance + field_cells, unreachable );
+            fill( hop_[to], hop_[to] + field_cells, (uint8_t)to );
+            return;
+        }
+        walk_distances( to, blocked_, distance );
+        for( int from = 0; from < field_cells; from++ )
+        {
+            hop_[to][from] = (uint8_t)first_step( from, distance );
+        }
+    }
+};
+
+// The Character heuristic's knobs. The defaults are compiled in, tuned_params.h replaces them when
+// HYPERSONIC_TUNED_PARAMS is 1, and a bot can be handed another set at runtime.
+struct CharacterParams
+{
+    int closest_boxes = 5;          // boxes marked as taken out ahead of a bomb being placed
+    int danger_timeout = 3;         // blast cells going off within this many turns are not walked into
+    int box_value = 2;              // heatmap weight of a plain box
+    int item_box_value = 3;         // and of a box hiding an upgrade
+    int box_score = 8;              // bomb spot score per heatmap point
+    int walk_cost = 1;              // and its cost per step to get there
+};
+
+#ifndef HYPERSONIC_TUNED_PARAMS
+#define HYPERSONIC_TUNED_PARAMS 0
+#endif
+
+#if HYPERSONIC_TUNED_PARAMS
+#include "tuned_params.h"
+constexpr CharacterParams default_character_params = tuned_character_params;
+#else
+constexpr CharacterParams default_character_params;
+#endif
+
+// Names and the range worth trying for every knob, for loading and tuning
+struct CharacterParamInfo
+{
+    const char* name;
+    int CharacterParams::* field;
+    int low;
+    int high;
+};
+
+constexpr CharacterParamInfo character_param_info[] = {
+    { "closest_boxes", &CharacterParams::closest_boxes, 1, 8 },
+    { "danger_timeout", &CharacterParams::danger_timeout, 1, 7 },
+    { "box_value", &CharacterParams::box_value, 1, 12 },
+    { "item_box_value", &CharacterParams::item_box_value, 1, 12 },
+    { "box_score", &CharacterParams::box_score, 1, 32 },
+    { "walk_cost", &CharacterParams::walk_cost, 0, 8 },
+};
+
+// Reads "name value" lines, # starts a comment; values are clamped to their range.
+// False if the file can't be read or has a name not known.
+inline bool load_character_params( const char* path, CharacterParams& params )
+{
+    FILE* file = fopen( path, "r" );
+    if( !file ) return false;
+    bool ok = true;
+    char line[256];
+    while( fgets( line, sizeof line, file ) )
+    {
+        char name[64];
+        int value;
+        if( line[0] == '#' || sscanf( line, "%63s %d", name, &value ) != 2 ) continue;
+        bool known = false;
+        for( const CharacterParamInfo& info: character_param_info )
+        {
+            if( strcmp( info.name, name ) ) continue;
+            params.*info.field = max( info.low, min( value, info.high ) );
+            known = true;
+        }
+        ok = ok && known;
+    }
+    fclose( file );
+    return ok;
+}
+
+// Weighted count of boxes a bomb would destroy, for every cell of the grid at once.
+// Each row and column is swept both ways remembering the nearest blocker; only the lines where a
+// blocker changed since the previous update are swept again.
+struct BombHeatmap
+{
+    // rebuilds what changed for the current board, bomb reach and box weights;
+    // boxes hiding an upgrade are usually worth a bit more
+    void update( const Board& board, int reach, int box_value, int item_box_value )
+    {
+        uint8_t blocker[field_cells];
+        uint8_t weight[field_cells];
+        const Bitboard blockers = board.walls | board.boxes | board.items() | board.doomed;
+        const Bitboard live_boxes = board.boxes.without( board.doomed );
+        const Bitboard item_boxes = board.range_boxes | board.count_boxes;
+        for( int i = 0; i < field_cells; i++ )
+        {
+            blocker[i] = blockers.test( i );
+            weight[i] = (uint8_t)( live_boxes.test( i ) ? ( item_boxes.test( i ) ? item_box_value : box_value ) : 0 );
+        }
+
+        bool dirty_rows[field_height] = {};
+        bool dirty_cols[field_width] = {};
+        const bool full = reach != reach_;
+        for( int i = 0; i < field_cells; i++ )
+        {
+            if( full || blocker[i] != blocker_[i] || weight[i] != weight_[i] )
+            {
+                dirty_rows[i / field_width] = true;
+                dirty_cols[i % field_width] = true;
+            }
+        }
+        copy( blocker, blocker + field_cells, blocker_ );
+        copy( weight, weight + field_cells, weight_ );
+        reach_ = reach;
+
+        for( int r = 0; r < field_height; r++ )
+        {
+            if( dirty_rows[r] ) sweep( r * field_width, 1, field_width, across_ );
+        }
+        for( int c = 0; c < field_width; c++ )
+        {
+            if( dirty_cols[c] ) sweep( c, field_width, field_height, along_ );
+        }
+
+        // no bomb goes on a box or a wall
+        const Bitboard solid = board.walls | board.boxes;
+        for( int i = 0; i < field_cells; i++ )
+        {
+            value_[i] = solid.test( i ) ? 0 : across_[i] + along_[i];
+        }
+    }
+
+    int at( int i ) const { return value_[i]; }
+    int at( const Position& p ) const { return value_[cell_index( p )]; }
+
+private:
+    uint8_t blocker_[field_cells] = {};
+    uint8_t weight_[field_cells] = {};
+    uint8_t across_[field_cells] = {};  // from the row sweeps
+    uint8_t along_[field_cells] = {};   // from the column sweeps
+    uint8_t value_[field_cells] = {};
+    int reach_ = -1;
+
+    // both directions along one line of cells
+    void sweep( int first, int stride, int length, uint8_t out[field_cells] )
+    {
+        int hit = 0, distance = field_cells;
+        for( int k = 0, i = first; k < length; k++, i += stride )
+        {
+            out[i] = distance <= reach_ ? hit : 0;
+            hit = blocker_[i] ? weight_[i] : hit;
+            distance = blocker_[i] ? 1 : distance + 1;
+        }
+        hit = 0, distance = field_cells;
+        for( int k = 0, i = first + ( length - 1 ) * stride; k < length; k++, i -= stride )
+        {
+            out[i] += distance <= reach_ ? hit : 0;
+            hit = blocker_[i] ? weight_[i] : hit;
+            distance = blocker_[i] ? 1 : distance + 1;
+        }
+    }
+};
+
+struct Field
+{
+    explicit Field( const CharacterParams& params = default_character_params ): params_( params ) {}
+
+    const CharacterParams& params() const
+    {
+        return params_;
+    }
+
+    void clear()
+    {
+        PROFILE_SCOPE( probe_clear );
+        field_ = Board();
+        rows_read_ = 0;
+        paths_valid_ = false;
+    }
+
+    void update_rows(const string& row)
+    {
+        update_rows( row.data(), (int)row.size() );
+    }
+    void update_rows( const char* row, int length )
+    {
+        for( int c = 0; c < field_width && c < length; c++ )
+        {
+            const int i = rows_read_ * field_width + c;
+            switch( row[c] )
+            {
+            case Symbol::wall:
+                field_.walls.set( i );
+                break;
+            case Symbol::box_witn_range:
+                field_.range_boxes.set( i );
+                field_.boxes.set( i );
+                break;
+            case Symbol::box_witn_bomb:
+                field_.count_boxes.set( i );
+                field_.boxes.set( i );
+                break;
+            case Symbol::box:
+                field_.boxes.set( i );
+                break;
+            default:
+                break;
+            }
+        }
+        rows_read_++;
+    }
+
+    void set_distances( const DistanceTable* distances )
+    {
+        distances_ = distances;
+    }
+
+    void set_blast_rays( const BlastRays* rays )
+    {
+        rays_ = rays;
+    }
+
+    void set_character_pos(const Position& p)
+    {
+        char_pos = p;
+        paths_valid_ = false;
+    }
+
+    void set_range_upgrade(const Position& p)
+    {
+        field_.range_items.set( p );
+    }
+
+    void set_count_upgrade(const Position& p)
+    {
+        field_.count_items.set( p );
+    }
+
+    void set_bomb(const Position& p, int range, int timeout)
+    {
+        if( !field_.bombs.test( p ) ) // register only new
+        {
+            field_.bombs.set( p );
+            paths_valid_ = false;
+            bomb_timer_[cell_index( p )] = (uint8_t)timeout;
+            bomb_reach_[cell_index( p )] = (uint8_t)range;
+        }
+    }
+    
+    bool is_in_blast_range(const Position& p)
+    {
+        return ( field_.blast | field_.bombs ).test( p );
+    }
+
+    // Once all bombs are known: resolve chains and paint blast zones by the step they really go off
+    void update_bomb_affected_boxes()
+    {
+        PROFILE_SCOPE( probe_danger );
+        danger_map_.compute( field_, *rays_, bomb_timer_, bomb_reach_ );
+
+        const Bitboard stoppers = field_.walls | field_.boxes | field_.items() | field_.bombs;
+        for( int i = 0; i < field_cells; i++ )
+        {
+            const int timeout = danger_map_.detonation[i];
+            if( !timeout ) continue;
+            if( field_.boxes.test( i ) )
+            {
+                field_.doomed.set( i ); // count boxes, but no blast behind it
+            }
+            else if( stoppers.test( i ) )
+            {
+                continue;
+            }
+            else if( timeout <= params_.danger_timeout )
+            {
+                field_.danger.set( i );
+            }
+            else
+            {
+                field_.blast.set( i );
+            }
+        }
+    }
+
+    // The few nearest boxes, as many as the params ask for up to capacity, kept in place so the turn
+    // does not allocate
+    struct BoxList
+    {
+        static constexpr int capacity = 8;
+        Position cells[capacity] = { {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1}, {-1, -1} };
+        int count = 0;
+    };
+
+    BoxList get_closest_boxes_from(Position from, int range = 0)
+    {
+        PROFILE_SCOPE( probe_closest_boxes );
+        BoxList ret;
+        const int limit = max( 1, min( params_.closest_boxes, BoxList::capacity ) );
+
+        // cells a bomb dropped at from would blast
+        Bitboard future_blast;
+        if( range )
+        {
+            const Bitboard stoppers = field_.boxes | field_.items() | field_.bombs;
+            walk_blast( *rays_, cell_index( from ), range, [&]( int i ){
+                if( field_.walls.test( i ) ) return true;
+                future_blast.set( i );
+                return stoppers.test( i );
+            } );
+        }
+        
+        BFSqueue( from, [&](const Position& p){
+            if( field_.walls.test( p ) )
+            {
+                //cerr << "Pos has a wall" << endl;
+                return BFSresult::ignore;
+            }
+            
+            if( ( field_.doomed | field_.danger ).test( p ) )
+            {
+                //cerr << "Pos has a blast zone" << endl;
+                return BFSresult::ignore;
+            }
+            
+            if( future_blast.test( p ) )
+            {
+                //cerr << "Pos will be affected by future bomb" << endl;
+                if( field_.is_box( p ) )
+                {
+                    field_.doomed.set( p ); // for best search
+                    return BFSresult::ignore;
+                }
+                if( field_.is_item( p ) )
+                {
+                    field_.doomed.set( p ); // for best search
+                    // process neighbours
+                }
+                field_.blast.set( p ); // for best search
+            }
+            
+            if( field_.is_box( p ) )
+            {
+                //cerr << "Pos found" << endl;
+                ret.cells[ret.count++] = p;
+                
+                if( ret.count == limit )
+                {
+                    return BFSresult::found; // break search
+                }
+                
+                return BFSresult::ignore; // do not process behind blasted box
+            }
+            
+            return BFSresult::continue_search;
+        } );
+
+        return ret;
+    }
+
+    // Where a bomb takes out the most, walking there costs a little
+    Position best_place_to_bomb( const int range )
+    {
+        heatmap_.update( field_, range, params_.box_value, params_.item_box_value );
+        const PathMap& paths = paths_from_character();
+
+        int best_score = 0;
+        Position best_pos = Position(-1, -1);
+        for( int i = 0; i < field_cells; i++ )
+        {
+            const int value = heatmap_.at( i );
+            if( !value || !applicable( cell_position( i ) ) ) continue;
+            const int score = value * params_.box_score - paths.distance[i] * params_.walk_cost;
+            if( score > best_score )
+            {
+                best_score = score;
+                best_pos = cell_position( i );
+            }
+        }
+        return best_pos;
+    }
+
+    // Closest cell no blast will reach that we can get to, passing cells before they go off
+    Position get_closest_safe_spot_from( const Position& from )
+    {
+        Position safe = from;
+        danger_map_.escape( from, safe );
+        return safe;
+    }
+    
+    bool safe_to_bomb( const Position& p, int range )
+    {
+        PROFILE_SCOPE( probe_safe_to_bomb );
+        DangerMap with_bomb;
+        with_bomb.compute( field_, *rays_, bomb_timer_, bomb_reach_, cell_index( p ), range );
+        Position safe = p;
+        return with_bomb.escape( p, safe ) >= 0;
+    }
+    
+    bool blast_danger( const Position& p ) const
+    {
+        return is_in_field( p ) && field_.danger.test( p );
+    }
+
+    string print()
+    {
+        return print( field_ );
+    }
+    string print( const Board& f ) const
+    {
+        string res;
+        for( int r = 0; r < field_height; r++ )
+        {
+            for( int c = 0; c < field_width; c++ )
+            {
+                res += symbol_at( f, {r, c} );
+            }
+            res += "\n";
+        }
+        return res;
+    }
+
+    Board field_;
+
+    enum Symbol
+    {
+        empty = '.',
+        processed = ',',
+        character = '!',
+        box = '0',
+        box_witn_range = '1',
+        box_witn_bomb = '2',
+        box_blasted = 'a',
+        item_blasted = 'b',
+        bomb = '@',
+        blast = '#',
+        about_to_blast = '$',
+        range_upgrade = 'R',
+        count_upgrade = 'C',
+        wall = 'X'
+    };
+
+private:
+    friend struct FieldBenchmark; // times the private BFS helpers
+    CharacterParams params_;
+    Position char_pos = {-1, -1};
+    int rows_read_ = 0;
+    uint8_t bomb_timer_[field_cells] = {};
+    uint8_t bomb_reach_[field_cells] = {};
+    DangerMap danger_map_;
+    uint16_t visited_[field_cells] = {};
+    uint16_t epoch_ = 0;
+    PathMap paths_;
+    bool paths_valid_ = false;
+    const DistanceTable* distances_ = nullptr;
+    const BlastRays* rays_ = &grid_rays;
+    BombHeatmap heatmap_;
+    
+    bool is_in_field( const Position& p ) const
+    {
+        return p.row >= 0 && p.row < field_height && p.col >= 0 && p.col < field_width;
+    }
+
+    bool applicable( const Position& p )
+    {
+        return p != char_pos && // not Cracracter's current pos, as currently bomb is being placed here
+               !field_.is_obstacle( p ) && // not a box/wall so that bomb can be places
+               !field_.blast.test( p ) && // do not stand on other bomb's blast range
+               has_path( char_pos, p ); // pathi to this position is clear
+    }
+
+    char symbol_at( const Board& f, const Position& p ) const
+    {
+        if( f.walls.test( p ) ) return Symbol::wall;
+        if( f.boxes.test( p ) )
+        {
+            if( f.doomed.test( p ) ) return Symbol::box_blasted;
+            if( f.range_boxes.test( p ) ) return Symbol::box_witn_range;
+            if( f.count_boxes.test( p ) ) return Symbol::box_witn_bomb;
+            return Symbol::box;
+        }
+        if( f.items().test( p ) )
+        {
+            if( f.doomed.test( p ) ) return Symbol::item_blasted;
+            return f.range_items.test( p ) ? Symbol::range_upgrade : Symbol::count_upgrade;
+        }
+        if( f.bombs.test( p ) ) return Symbol::bomb;
+        if( p == char_pos ) return Symbol::character;
+        if( f.danger.test( p ) ) return Symbol::about_to_blast;
+        if( f.blast.test( p ) ) return Symbol::blast;
+        return Symbol::empty;
+    }
+    
+    enum BFSresult
+    {
+        ignore = -1,
+        found = 0,
+        continue_search = 1
+    };
+    // Every cell is visited at most once, visits are told apart by an epoch stamp so nothing needs clearing.
+    // When paths is given, distances and parents of all visited cells are written to it.
+    template<class F> Position BFSqueue( const Position& initial, F f, PathMap* paths = nullptr )
+    {
+        PROFILE_SCOPE( probe_bfs );
+        if( ++epoch_ == 0 ) // wrapped around, old stamps could collide
+        {
+            fill( visited_, visited_ + field_cells, 0 );
+            epoch_ = 1;
+        }
+        if( paths )
+        {
+            fill( paths->distance, paths->distance + field_cells, PathMap::unreachable );
+        }
+
+        uint8_t queue[field_cells];
+        int head = 0, tail = 0;
+        const int start = cell_index( initial );
+        queue[tail++] = (uint8_t)start;
+        visited_[start] = epoch_;
+        if( paths )
+        {
+            paths->distance[start] = 0;
+            paths->parent[start] = (uint8_t)start;
+        }
+
+        while( head < tail )
+        {
+            const int next = queue[head++];
+            PROFILE_COUNT( counter_bfs_nodes, 1 );
+
+            BFSresult f_res = f( cell_position( next ) );
+            //cerr << "BFS callback result: " << f_res << endl;
+            if( f_res == BFSresult::ignore )
+            {
+                continue;
+            }
+            else if( f_res == BFSresult::found )
+            {
+                return cell_position( next );
+            }
+            // else BFSresult::continue_search
+
+            const Neighbours& around = neighbours_of[next];
+            for( int k = 0; k < around.count; k++ )
+            {
+                const int n = around.cells[k];
+                if( visited_[n] == epoch_ )
+                {
+                    continue;
+                }
+                visited_[n] = epoch_;
+                queue[tail++] = (uint8_t)n;
+                if( paths )
+                {
+                    paths->distance[n] = paths->distance[next] + 1;
+                    paths->parent[n] = (uint8_t)next;
+                }
+            }
+        }
+        
+        //cerr << "Not found" << endl;
+        return initial;
+    }
+
+    // Walkable cells around the character, rebuilt once per turn on first use.
+    // Obstacles next to a walkable cell get a distance too but are not walked through.
+    const PathMap& paths_from_character()
+    {
+        if( !paths_valid_ )
+        {
+            BFSqueue( char_pos, [&](const Position& p){
+                return p != char_pos && field_.is_obstacle( p ) ? BFSresult::ignore : BFSresult::continue_search;
+            }, &paths_ );
+            paths_valid_ = true;
+        }
+        return paths_;
+    }
+    
+    bool has_path( const Position& from, const Position& to )
+    {
+        PROFILE_COUNT( counter_has_path, 1 );
+        if( !is_in_field( from ) || !is_in_field( to ) )
+        {
+            return false;
+        }
+        if( from == to )
+        {
+            return true;
+        }
+        if( field_.is_obstacle( from ) && from != char_pos ) // if standing on placed bomb path is clear
+        {
+            return false;
+        }
+        
+        if( from == char_pos )
+        {
+            return paths_from_character().reachable( cell_index( to ) );
+        }
+        if( distances_ && distances_->blocked() == ( field_.walls | field_.boxes ) && !field_.bombs.any() )
+        {
+            // static layout is all that matters, one lookup; the target may be an obstacle next to the walk
+            const int target = cell_index( to );
+            if( distances_->walkable( target ) )
+            {
+                return distances_->distance( cell_index( from ), target ) != DistanceTable::unreachable;
+            }
+            const Neighbours& around = neighbours_of[target];
+            for( int k = 0; k < around.count; k++ )
+            {
+                if( distances_->distance( cell_index( from ), around.cells[k] ) != DistanceTable::unreachable ) return true;
+            }
+            return false;
+        }
+
+        //cerr << "Path from " << from.row << ":" << from.col << " to  " << to.row << ":" << to.col << endl;
+        // flood fill the free cells, the target itself may be an obstacle
+        const Bitboard target = Bitboard::of( to );
+        const Bitboard passable = ~field_.obstacles();
+        Bitboard reached = Bitboard::of( from );
+        while( true )
+        {
+            const Bitboard frontier = reached.neighbours();
+            if( ( frontier & target ).any() )
+            {
+                return true;
+            }
+            const Bitboard grown = reached | ( frontier & passable );
+            if( grown == reached )
+            {
+                return false;
+            }
+            reached = grown;
+        }
+    }
+};
+
+// Small deterministic generator, cheap enough for playouts
+struct Random
+{
+    explicit Random( uint64_t seed = 88172645463325252ull ): state( seed ? seed : 1 )
+    {}
+
+    uint64_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    int below( int n )
+    {
+        return (int)( ( ( next() >> 32 ) * (uint64_t)n ) >> 32 );
+    }
+
+    uint64_t state;
+};
+
+// Fixed capacity storage handed out front to back, allocated once and emptied in one step
+template<class T> struct Pool
+{
+    explicit Pool( uint32_t capacity ): items_( new T[capacity] ), capacity_( capacity )
+    {}
+
+    void reset()
+    {
+        used_ = 0;
+    }
+
+    // n consecutive items, nullptr once the pool is full
+    T* allocate( uint32_t n = 1 )
+    {
+        if( used_ + n > capacity_ ) return nullptr;
+        T* items = &items_[used_];
+        used_ += n;
+        return items;
+    }
+
+    uint32_t size() const
+    {
+        return used_;
+    }
+
+    T& operator[]( uint32_t i )
+    {
+        return items_[i];
+    }
+    const T& operator[]( uint32_t i ) const
+    {
+        return items_[i];
+    }
+
+private:
+    unique_ptr<T[]> items_;
+    uint32_t capacity_;
+    uint32_t used_ = 0;
+};
+
+// Random keys for incremental position hashing, fixed seed so hashes are stable between runs
+struct Zobrist
+{
+    static const Zobrist& get()
+    {
+        static const Zobrist z;
+        return z;
+    }
+
+    uint64_t box[field_cells][3];          // plain, range upgrade inside, bomb upgrade inside
+    uint64_t item[field_cells][2];
+    uint64_t bomb_timer[field_cells][16];
+    uint64_t bomb_owner[field_cells][4];
+    uint64_t bomb_range[field_cells][32];
+    uint64_t player_cell[4][field_cells + 1]; // last slot stands for eliminated
+    uint64_t player_bombs[4][32];
+    uint64_t player_range[4][32];
+    uint64_t player_boxes[4][128];
+    uint64_t seat[4];                      // tells apart per player evaluations of one position
+
+private:
+    Zobrist()
+    {
+        Random rng( 0x9E3779B97F4A7C15ull );
+        auto fill = [&]( uint64_t* keys, size_t n ) { for( size_t i = 0; i < n; i++ ) keys[i] = rng.next(); };
+        fill( &box[0][0], sizeof( box ) / sizeof( uint64_t ) );
+        fill( &item[0][0], sizeof( item ) / sizeof( uint64_t ) );
+        fill( &bomb_timer[0][0], sizeof( bomb_timer ) / sizeof( uint64_t ) );
+        fill( &bomb_owner[0][0], sizeof( bomb_owner ) / sizeof( uint64_t ) );
+        fill( &bomb_range[0][0], sizeof( bomb_range ) / sizeof( uint64_t ) );
+        fill( &player_cell[0][0], sizeof( player_cell ) / sizeof( uint64_t ) );
+        fill( &player_bombs[0][0], sizeof( player_bombs ) / sizeof( uint64_t ) );
+        fill( &player_range[0][0], sizeof( player_range ) / sizeof( uint64_t ) );
+        fill( &player_boxes[0][0], sizeof( player_boxes ) / sizeof( uint64_t ) );
+        fill( seat, 4 );
+    }
+};
+
+// What a player asks the referee for in one turn: optionally drop a bomb, then step towards target
+struct Action
+{
+    static Action move( const Position& p ) { return { false, (uint8_t)cell_index( p ) }; }
+    static Action bomb( const Position& p ) { return { true, (uint8_t)cell_index( p ) }; }
+
+    bool place_bomb;
+    uint8_t target;
+};
+
+// Full game state as seen by the referee, fixed size so that it can be copied freely during search
+struct GameState
+{
+    static constexpr int max_players = 4;
+    static constexpr int bomb_timer_start = 8;
+    static constexpr int max_turns = 200;
+    static constexpr int stale_turns_limit = 20;
+    static constexpr int no_box_turns_limit = 20;
+    static constexpr uint8_t nowhere = 0xFF;
+
+    struct Player
+    {
+        uint8_t cell = nowhere;  // nowhere when the seat is empty
+        uint8_t bombs = 0;       // bombs the player can still place
+        uint8_t range = 0;       // referee range, counts the bomb cell itself
+        uint8_t boxes = 0;       // boxes destroyed so far, breaks elimination ties
+        bool alive = false;
+        int16_t eliminated_turn = -1;
+    };
+
+    Board board;
+    uint8_t bomb_timer[field_cells] = {};
+    uint8_t bomb_owner[field_cells] = {};
+    uint8_t bomb_range[field_cells] = {};
+    Player players[max_players];
+    int16_t turn = 0;
+    uint8_t stale_turns = 0;
+    uint8_t no_box_turns = 0;
+    uint8_t participants = 0;
+    bool finished = false;
+    uint64_t hash = 0;      // Zobrist key of cells, bombs, items and players, kept up to date by every change
+    const DistanceTable* distances = nullptr; // shared walking table, only trusted while its boxes match ours
+    const BlastRays* rays = &grid_rays;       // wall-clipped once the walls are known
+
+    void load_row( int row, const string& cells )
+    {
+        load_row( row, cells.data(), (int)cells.size() );
+    }
+    void load_row( int row, const char* cells, int length )
+    {
+        for( int c = 0; c < field_width && c < length; c++ )
+        {
+            const int i = row * field_width + c;
+            switch( cells[c] )
+            {
+            case 'X':
+                board.walls.set( i );
+                break;
+            case '1':
+                board.range_boxes.set( i );
+                board.boxes.set( i );
+                hash ^= Zobrist::get().box[i][1];
+                break;
+            case '2':
+                board.count_boxes.set( i );
+                board.boxes.set( i );
+                hash ^= Zobrist::get().box[i][2];
+                break;
+            case '0':
+                board.boxes.set( i );
+                hash ^= Zobrist::get().box[i][0];
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void add_player( int id, const Position& p, int bombs, int range )
+    {
+        Player& player = players[id];
+        if( player.cell == nowhere )
+        {
+            participants++;
+        }
+        else
+        {
+            hash ^= player_key( id );
+        }
+        player.cell = (uint8_t)cell_index( p );
+        player.bombs = (uint8_t)bombs;
+        player.range = (uint8_t)range;
+        player.alive = true;
+        hash ^= player_key( id );
+    }
+
+    void add_bomb( int owner, const Position& p, int timer, int range )
+    {
+        const int i = cell_index( p );
+        board.bombs.set( i );
+        bomb_timer[i] = (uint8_t)timer;
+        bomb_owner[i] = (uint8_t)owner;
+        bomb_range[i] = (uint8_t)range;
+        hash ^= bomb_key( i );
+    }
+
+    void add_item( const Position& p, int type )
+    {
+        if( type == 1 )
+        {
+            board.range_items.set( p );
+            hash ^= Zobrist::get().item[cell_index( p )][0];
+        }
+        else if( type == 2 )
+        {
+            board.count_items.set( p );
+            hash ^= Zobrist::get().item[cell_index( p )][1];
+        }
+    }
+
+    uint64_t player_key( int id ) const
+    {
+        const Zobrist& z = Zobrist::get();
+        const Player& player = players[id];
+        if( player.cell == nowhere )
+        {
+            return 0;
+        }
+        return z.player_cell[id][player.alive ? player.cell : field_cells] ^ z.player_bombs[id][player.bombs & 31] ^
+               z.player_range[id][player.range & 31] ^ z.player_boxes[id][player.boxes & 127];
+    }
+
+    uint64_t bomb_key( int i ) const
+    {
+        const Zobrist& z = Zobrist::get();
+        return z.bomb_timer[i][bomb_timer[i] & 15] ^ z.bomb_owner[i][bomb_owner[i] & 3] ^ z.bomb_range[i][bomb_range[i] & 31];
+    }
+
+    // From scratch, to check the incremental updates
+    uint64_t compute_hash() const
+    {
+        const Zobrist& z = Zobrist::get();
+        uint64_t h = 0;
+        board.boxes.for_each( [&]( int i ){ h ^= z.box[i][board.range_boxes.test( i ) ? 1 : board.count_boxes.test( i ) ? 2 : 0]; } );
+        board.range_items.for_each( [&]( int i ){ h ^= z.item[i][0]; } );
+        board.count_items.for_each( [&]( int i ){ h ^= z.item[i][1]; } );
+        board.bombs.for_each( [&]( int i ){ h ^= bomb_key( i ); } );
+        for( int id = 0; id < max_players; id++ )
+        {
+            h ^= player_key( id );
+        }
+        return h;
+    }
+
+    // Boxes destroyed are not part of the referee input, they are carried over from turn to turn
+    void set_boxes( int id, int boxes )
+    {
+        hash ^= player_key( id );
+        players[id].boxes = (uint8_t)boxes;
+        hash ^= player_key( id );
+    }
+
+    int alive_players() const
+    {
+        int n = 0;
+        for( const auto& player: players )
+        {
+            n += player.alive;
+        }
+        return n;
+    }
+
+    // Higher is better: survivors first, then later eliminations, then boxes destroyed
+    int placement_key( int id ) const
+    {
+        const Player& player = players[id];
+        const int survived = player.alive ? max_turns + 1 : player.eliminated_turn;
+        return survived * 256 + player.boxes;
+    }
+
+    // One referee turn: explosions, then bombs are placed, then players move and pick up items
+    void step( const Action actions[max_players] )
+    {
+        if( finished )
+        {
+            return;
+        }
+
+        bool changed = board.bombs.any();
+        explode_bombs();
+
+        // bombs placed this turn do not block anybody entering their cell this turn
+        const Bitboard blocking = board.walls | board.boxes | board.bombs;
+
+        for( int id = 0; id < max_players; id++ )
+        {
+            Player& player = players[id];
+            if( player.alive && actions[id].place_bomb && player.bombs && !board.bombs.test( player.cell ) )
+            {
+                board.bombs.set( player.cell );
+                bomb_timer[player.cell] = bomb_timer_start;
+                bomb_owner[player.cell] = (uint8_t)id;
+                bomb_range[player.cell] = player.range;
+                hash ^= bomb_key( player.cell ) ^ player_key( id );
+                player.bombs--;
+                hash ^= player_key( id );
+                changed = true;
+            }
+        }
+
+        for( int id = 0; id < max_players; id++ )
+        {
+            Player& player = players[id];
+            if( !player.alive )
+            {
+                continue;
+            }
+            const uint8_t next = next_step( player.cell, actions[id].target, blocking );
+            if( next != player.cell )
+            {
+                hash ^= player_key( id );
+                player.cell = next;
+                hash ^= player_key( id );
+                changed = true;
+            }
+        }
+
+        Bitboard picked;
+        for( int id = 0; id < max_players; id++ )
+        {
+            Player& player = players[id];
+            if( !player.alive || !board.items().test( player.cell ) )
+            {
+                continue;
+            }
+            hash ^= player_key( id );
+            if( board.range_items.test( player.cell ) )
+            {
+                player.range++;
+            }
+            else
+            {
+                player.bombs++;
+            }
+            hash ^= player_key( id );
+            picked.set( player.cell );
+        }
+        if( picked.any() )
+        {
+            set_items( board.range_items.without( picked ), board.count_items.without( picked ) );
+            changed = true;
+        }
+
+        turn++;
+        stale_turns = changed ? 0 : stale_turns + 1;
+        no_box_turns = board.boxes.any() ? 0 : no_box_turns + 1;
+
+        if( ( participants > 1 && alive_players() <= 1 ) ||
+            turn >= max_turns || stale_turns >= stale_turns_limit || no_box_turns >= no_box_turns_limit )
+        {
+            finished = true;
+        }
+    }
+
+    // Cell a player ends up on when asking to move towards target: one step along a shortest path,
+    // or towards the reachable cell closest to target when it can't be reached.
+    // Looked up in the distance table unless bombs change the walk.
+    uint8_t next_step( uint8_t from, uint8_t target, const Bitboard& blocking ) const
+    {
+        if( from == target )
+        {
+            return from;
+        }
+
+        const Position f = cell_position( from );
+        const Position t = cell_position( target );
+        if( abs( f.row - t.row ) + abs( f.col - t.col ) == 1 )
+        {
+            return blocking.test( target ) ? from : target;
+        }
+
+        // a bomb under the player does not keep it from leaving
+        Bitboard blocked = blocking;
+        blocked.reset( from );
+
+        if( distances && distances->blocked() == ( board.walls | board.boxes ) )
+        {
+            const Bitboard bombs = blocked.without( distances->blocked() );
+            if( !bombs.any() ||
+                ( distances->distance( from, target ) != DistanceTable::unreachable && distances->clear_route( from, target, bombs ) ) )
+            {
+                return (uint8_t)distances->step( from, target );
+            }
+        }
+
+        uint8_t distance_from[field_cells];
+        walk_distances( from, blocked, distance_from );
+        const int goal = move_goal( target, distance_from );
+        if( goal == from )
+        {
+            return from;
+        }
+        uint8_t distance_to_goal[field_cells];
+        walk_distances( goal, blocked, distance_to_goal );
+        return (uint8_t)first_step( from, distance_to_goal );
+    }
+
+private:
+    void set_items( const Bitboard& range_items, const Bitboard& count_items )
+    {
+        const Zobrist& z = Zobrist::get();
+        ( board.range_items ^ range_items ).for_each( [&]( int i ){ hash ^= z.item[i][0]; } );
+        ( board.count_items ^ count_items ).for_each( [&]( int i ){ hash ^= z.item[i][1]; } );
+        board.range_items = range_items;
+        board.count_items = count_items;
+    }
+
+    // Decrements timers and resolves every detonation of the turn including chain reactions
+    void explode_bombs()
+    {
+        const Zobrist& z = Zobrist::get();
+        uint8_t queue[field_cells];
+        int head = 0, tail = 0;
+        Bitboard exploding;
+        board.bombs.for_each( [&]( int i ){
+            hash ^= z.bomb_timer[i][bomb_timer[i] & 15] ^ z.bomb_timer[i][( bomb_timer[i] - 1 ) & 15];
+            if( --bomb_timer[i] == 0 )
+            {
+                exploding.set( i );
+                queue[tail++] = (uint8_t)i;
+            }
+        } );
+        if( !tail )
+        {
+            return;
+        }
+
+        const Bitboard items = board.items();
+        Bitboard blasted;
+        uint8_t box_hit_by[field_cells];
+        Bitboard boxes_hit;
+
+        while( head < tail )
+        {
+            const int b = queue[head++];
+            blasted.set( b );
+            walk_blast( *rays, b, bomb_range[b] - 1, [&]( int i ){
+                if( board.walls.test( i ) ) return true;
+                blasted.set( i );
+                if( board.boxes.test( i ) )
+                {
+                    if( !boxes_hit.test( i ) )
+                    {
+                        boxes_hit.set( i );
+                        box_hit_by[i] = 0;
+                    }
+                    box_hit_by[i] |= 1 << bomb_owner[b];
+                    return true;
+                }
+                if( items.test( i ) ) return true;
+                if( board.bombs.test( i ) )
+                {
+                    if( !exploding.test( i ) )
+                    {
+                        exploding.set( i );
+                        queue[tail++] = (uint8_t)i;
+                    }
+                    return true;
+                }
+                return false;
+            } );
+        }
+
+        // every owner whose blast reached a box gets the credit, bombs go back to their owners
+        for( int id = 0; id < max_players; id++ )
+        {
+            hash ^= player_key( id );
+        }
+        boxes_hit.for_each( [&]( int i ){
+            for( int id = 0; id < max_players; id++ )
+            {
+                if( box_hit_by[i] & ( 1 << id ) )
+                {
+                    players[id].boxes++;
+                }
+            }
+            hash ^= z.box[i][board.range_boxes.test( i ) ? 1 : board.count_boxes.test( i ) ? 2 : 0];
+        } );
+        exploding.for_each( [&]( int i ){
+            hash ^= bomb_key( i );
+            players[bomb_owner[i]].bombs++;
+            bomb_timer[i] = 0;
+        } );
+        board.bombs = board.bombs.without( exploding );
+
+        for( auto& player: players )
+        {
+            if( player.alive && blasted.test( player.cell ) )
+            {
+                player.alive = false;
+                player.eliminated_turn = turn;
+            }
+        }
+        for( int id = 0; id < max_players; id++ )
+        {
+            hash ^= player_key( id );
+        }
+
+        // items appear once all explosions are applied, so the fresh ones survive this turn
+        set_items( board.range_items.without( blasted ) | ( boxes_hit & board.range_boxes ),
+                   board.count_items.without( blasted ) | ( boxes_hit & board.count_boxes ) );
+        board.boxes = board.boxes.without( boxes_hit );
+        board.range_boxes = board.range_boxes.without( boxes_hit );
+        board.count_boxes = board.count_boxes.without( boxes_hit );
+    }
+};
+
+// What every player did between two consecutive observed states: the cell they ended up on, and a bomb
+// if a fresh one of theirs appeared where they stood. Players gone from after did nothing.
+void observed_actions( const GameState& before, const GameState& after, Action actions[GameState::max_players] )
+{
+    for( int id = 0; id < GameState::max_players; id++ )
+    {
+        const uint8_t from = before.players[id].cell;
+        const uint8_t to = after.players[id].cell;
+        if( !before.players[id].alive || to == GameState::nowhere )
+        {
+            actions[id] = { false, from == GameState::nowhere ? (uint8_t)0 : from };
+            continue;
+        }
+        const bool bomb = after.board.bombs.test( from ) && !before.board.bombs.test( from ) && after.bomb_owner[from] == id;
+        actions[id] = { bomb, to };
+    }
+}
+
+// Search's reward for a playout: boxes destroyed since the root and the ones already under our bombs,
+// upgrades, rivals gone, less for standing in a blast. bombs counts the ones on the field too.
+// The score is a whole number, squashed through a table; past its ends the value is within 1e-10 of 0 or 1.
+inline float playout_value( int boxes_gained, int pending_boxes, int range, int bombs, int rivals_out, bool threatened )
+{
+    constexpr int lowest = -480, highest = 480;
+    static const auto squashed = []{
+        array<float, highest - lowest + 1> table;
+        for( int s = lowest; s <= highest; s++ )
+        {
+            table[s - lowest] = (float)( 0.5 + 0.5 * tanh( s / 40.0 ) );
+        }
+        return table;
+    }();
+
+    int score = 10 * boxes_gained + 6 * pending_boxes;
+    score += 4 * min( range - 3, 4 ) + 4 * min( bombs - 1, 3 );
+    score += 8 * rivals_out;
+    if( threatened )
+    {
+        score -= 15;
+    }
+    return squashed[min( max( score, lowest ), highest ) - lowest];
+}
+
+// Fixed-size cache of position evaluations keyed by Zobrist hash.
+// Four entries share one cache line; entries from earlier turns are replaced first, then the least reused one.
+struct TranspositionTable
+{
+    static constexpr int bucket_entries = 4;
+
+    struct Entry
+    {
+        uint64_t key = 0;
+        float value = 0;
+        uint16_t generation = 0;
+        uint16_t hits = 0;
+    };
+
+    struct alignas(64) Bucket
+    {
+        Entry entries[bucket_entries];
+    };
+
+    explicit TranspositionTable( int bucket_bits ): buckets_( size_t(1) << bucket_bits ), mask_( ( size_t(1) << bucket_bits ) - 1 )
+    {}
+
+    // new turn: everything stored so far becomes stale
+    void new_generation()
+    {
+        generation_++;
+        probes_ = 0;
+        hits_ = 0;
+    }
+
+    bool probe( uint64_t key, float& value )
+    {
+        probes_++;
+        for( Entry& e: buckets_[key & mask_].entries )
+        {
+            if( e.key == key && e.generation == generation_ )
+            {
+                value = e.value;
+                if( e.hits < UINT16_MAX ) e.hits++;
+                hits_++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store( uint64_t key, float value )
+    {
+        Entry* victim = nullptr;
+        for( Entry& e: buckets_[key & mask_].entries )
+        {
+            if( e.key == key || e.generation != generation_ )
+            {
+                victim = &e;
+                break;
+            }
+            if( !victim || e.hits < victim->hits )
+            {
+                victim = &e;
+            }
+        }
+        *victim = { key, value, generation_, 0 };
+    }
+
+    double hit_rate() const
+    {
+        return probes_ ? (double)hits_ / probes_ : 0;
+    }
+
+private:
+    vector<Bucket> buckets_;
+    size_t mask_;
+    uint16_t generation_ = 1;
+    long long probes_ = 0;
+    long long hits_ = 0;
+};
+
+// Anytime Monte Carlo tree search over simultaneous moves, decoupled per player as in Smitsimax:
+// every player alive grows a tree of their own actions and picks from it by their own rewards,
+// the picks are played together. Four players cost four small trees instead of one over
+// every joint action. Runs until the deadline and returns our most visited first action.
+struct Search
+{
+    explicit Search( uint32_t capacity = node_capacity, int bucket_bits = evaluation_bucket_bits, Random rng = Random() ):
+        nodes_( capacity ), spare_( capacity ), capacity_( capacity ), evaluations_( bucket_bits ), rng_( rng )
+    {}
+
+    // stay, up, down, left, right; each one with or without a bomb
+    static constexpr int action_count = 10;
+    static constexpr int horizon = 12;           // turns simulated from the root, long enough to see own bombs go off
+    static constexpr uint32_t node_capacity = 1 << 20;
+    static constexpr double exploration = 0.7;
+    static constexpr int evaluation_bucket_bits = 16;   // 4 MB of cached evaluations
+
+    struct Stats
+    {
+        long long iterations = 0;
+        long long steps = 0;    // forward model calls
+        int depth = 0;          // deepest tree node reached
+        double seconds = 0;
+        long long reused = 0;   // playouts kept from the previous turn's tree, pondering included
+    };
+
+    Action best_action( const GameState& root, int me, chrono::steady_clock::time_point deadline )
+    {
+        PROFILE_SCOPE( probe_search );
+        if( !resume( root, me, deadline ) )
+        {
+            start( root, me );
+        }
+        run( deadline );
+
+        const Position at = cell_position( root.players[me].cell );
+        chosen_ = most_visited( me );
+        if( chosen_ < 0 )
+        {
+            return Action::move( at );
+        }
+        reusable_ = true;
+        return to_action( at, chosen_ );
+    }
+
+    // Searches on from the same root with our first move fixed to the one best_action chose,
+    // until stop is raised. Meant for the wait on the referee.
+    void ponder( const atomic<bool>& stop )
+    {
+        if( !reusable_ || ( nodes_.size() > capacity_ / 2 && !compact( &stop ) ) )
+        {
+            return;
+        }
+        while( !stop.load( memory_order_relaxed ) )
+        {
+            for( int i = 0; i < 64; i++ )
+            {
+                iterate( root_, chosen_ );
+            }
+        }
+    }
+
+    // New trees from root, optionally below a first action of ours already played
+    void start( const GameState& root, int me, int first_action = -1 )
+    {
+        reusable_ = false;
+        me_ = me;
+        stats_ = Stats();
+        evaluations_.new_generation();
+        nodes_.reset();
+        fill( top_, top_ + GameState::max_players, none );
+        root_ = root;
+        if( first_action >= 0 )
+        {
+            advance( root_, first_action );
+        }
+        plant();
+        set_baseline();
+    }
+
+    // Grows the trees in batches until the deadline, at least one batch
+    void run( chrono::steady_clock::time_point deadline )
+    {
+        const auto started = chrono::steady_clock::now();
+        do
+        {
+            for( int i = 0; i < 64; i++ )
+            {
+                iterate( root_ );
+            }
+        }
+        while( chrono::steady_clock::now() < deadline );
+        stats_.seconds += chrono::duration<double>( chrono::steady_clock::now() - started ).count();
+    }
+
+    // Nothing left to search below the root
+    bool terminal() const
+    {
+        return over( root_ );
+    }
+
+    // Average reward of everything we played out from the root
+    double mean_value() const
+    {
+        const Node& top = nodes_[top_[me_]];
+        return top.visits ? top.value / top.visits : 0;
+    }
+
+    // A player's most visited first action, -1 when they have no tree
+    int predicted( int id ) const
+    {
+        return most_visited( id );
+    }
+
+    const Stats& stats() const
+    {
+        return stats_;
+    }
+
+    static bool legal( const GameState& state, int id, int action )
+    {
+        const GameState::Player& player = state.players[id];
+        if( action >= 5 && ( !player.bombs || state.board.bombs.test( player.cell ) ) )
+        {
+            return false;
+        }
+        if( action % 5 == 0 )
+        {
+            return true;
+        }
+        const Position to = step_position( cell_position( player.cell ), action );
+        if( to.row < 0 || to.row >= field_height || to.col < 0 || to.col >= field_width )
+        {
+            return false;
+        }
+        return !state.board.obstacles().test( to );
+    }
+
+    // Formatted in place, valid until the next call
+    const char* report()
+    {
+        const double per_second = stats_.seconds > 0 ? stats_.steps / stats_.seconds : 0;
+        snprintf( report_, sizeof report_, "Search: iterations %lld, reused %lld, nodes/sec %lld, depth %d, tree %u, tt hits %d%%",
+                  stats_.iterations, stats_.reused, (long long)per_second, stats_.depth, nodes_.size(),
+                  (int)( evaluations_.hit_rate() * 100 ) );
+        return report_;
+    }
+
+    static Position step_position( const Position& at, int action )
+    {
+        const Position around[5] = { at, {at.row - 1, at.col}, {at.row + 1, at.col}, {at.row, at.col - 1}, {at.row, at.col + 1} };
+        return around[action % 5];
+    }
+
+    static Action to_action( const Position& at, int action )
+    {
+        const Position to = step_position( at, action );
+        return action >= 5 ? Action::bomb( to ) : Action::move( to );
+    }
+
+    // Inverse of to_action for a single step, -1 when the target is not next to at
+    static int action_index( const Position& at, const Action& action )
+    {
+        for( int a = 0; a < 5; a++ )
+        {
+            if( cell_index( step_position( at, a ) ) == action.target )
+            {
+                return action.place_bomb ? a + 5 : a;
+            }
+        }
+        return -1;
+    }
+
+    // Boxes that bombs of the player still lying on the board are going to destroy
+    static int pending_boxes( const GameState& state, int id )
+    {
+        int boxes = 0;
+        const Bitboard stoppers = state.board.walls | state.board.boxes | state.board.items() | state.board.bombs;
+        state.board.bombs.for_each( [&]( int b ){
+            if( state.bomb_owner[b] != id ) return;
+            walk_blast( *state.rays, b, state.bomb_range[b] - 1, [&]( int i ){
+                boxes += state.board.boxes.test( i );
+                return stoppers.test( i );
+            } );
+        } );
+        return boxes;
+    }
+
+    // The player stands in the blast of a bomb
+    static bool threatened( const GameState& state, int id )
+    {
+        const int at = state.players[id].cell;
+        if( state.board.bombs.test( at ) )
+        {
+            return true;
+        }
+        const Bitboard stoppers = state.board.walls | state.board.boxes | state.board.items() | state.board.bombs;
+        bool hit = false;
+        state.board.bombs.for_each( [&]( int b ){
+            walk_blast( *state.rays, b, state.bomb_range[b] - 1, [&]( int i ){
+                hit |= i == at;
+                return hit || stoppers.test( i );
+            } );
+        } );
+        return hit;
+    }
+
+private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Node
+    {
+        uint32_t first_child = 0;
+        uint8_t children = 0;
+        uint8_t action = 0;     // action of the tree's player leading into this node
+        bool expanded = false;
+        float value = 0;        // sum of rewards
+        uint32_t visits = 0;
+    };
+
+    Pool<Node> nodes_;
+    Pool<Node> spare_;      // compact() copies the live trees here, then the two swap
+    uint32_t top_[GameState::max_players] = { none, none, none, none };  // root of every player's tree
+    uint32_t capacity_;
+    GameState root_;
+    int chosen_ = -1;       // our first action sent to the referee
+    int root_boxes_[GameState::max_players] = {};
+    int root_alive_ = 0;
+    bool reusable_ = false;
+    char report_[128];
+    TranspositionTable evaluations_;
+    Stats stats_;
+    int me_ = 0;
+    Random rng_;
+
+    // Rewards count from the root on, what happened before the search is the same for every line
+    void set_baseline()
+    {
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            root_boxes_[id] = root_.players[id].boxes;
+        }
+        root_alive_ = root_.alive_players();
+    }
+
+    // A fresh tree for every player alive who has none
+    void plant()
+    {
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            if( !root_.players[id].alive )
+            {
+                top_[id] = none;
+            }
+            else if( top_[id] == none )
+            {
+                top_[id] = nodes_.size();
+                *nodes_.allocate() = Node();
+            }
+        }
+    }
+
+    // Starts from a copy of the root: the state is small enough that one copy beats
+    // taking back a dozen turns with undo_log.h, the benchmark compares the two.
+    // Every player walks down their own tree until one of them reaches a node not expanded yet,
+    // then the game is played out at random and each player backs up their own reward.
+    void iterate( const GameState& root, int forced = -1 )
+    {
+        GameState state = root;
+        PROFILE_COUNT( counter_board_copies, 1 );
+        uint32_t path[GameState::max_players][horizon + 1];
+        int length[GameState::max_players];
+        uint32_t at[GameState::max_players];
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            at[id] = top_[id];
+            path[id][0] = top_[id];
+            length[id] = top_[id] == none ? 0 : 1;
+        }
+
+        int depth = 0;
+        bool leaf = false;
+        while( !leaf && depth < horizon && !over( state ) )
+        {
+            Action actions[GameState::max_players];
+            for( int id = 0; id < GameState::max_players; id++ )
+            {
+                const GameState::Player& player = state.players[id];
+                if( at[id] == none || !player.alive )
+                {
+                    actions[id] = { false, player.alive ? player.cell : (uint8_t)0 };
+                    continue;
+                }
+                if( !nodes_[at[id]].expanded )
+                {
+                    expand( at[id], state, id );
+                    leaf = true;
+                }
+                const Node& node = nodes_[at[id]];
+                if( !node.children )
+                {
+                    // tree is full, this player goes on at random
+                    at[id] = none;
+                    actions[id] = to_action( cell_position( player.cell ), random_action( state, id ) );
+                    continue;
+                }
+                const uint32_t child = depth == 0 && id == me_ && forced >= 0 ? child_for( at[id], forced ) : select( node );
+                at[id] = child;
+                path[id][length[id]++] = child;
+
+                // a node is shared by every history of the others, which may have left the player
+                // somewhere its action does not fit; standing still stands in for it
+                const int action = nodes_[child].action;
+                actions[id] = legal( state, id, action ) ? to_action( cell_position( player.cell ), action ) : Action{ false, player.cell };
+            }
+            state.step( actions );
+            stats_.steps++;
+            depth++;
+        }
+        stats_.depth = max( stats_.depth, depth );
+
+        for( int d = depth; d < horizon && !over( state ); d++ )
+        {
+            Action actions[GameState::max_players];
+            for( int id = 0; id < GameState::max_players; id++ )
+            {
+                const GameState::Player& player = state.players[id];
+                actions[id] = player.alive ? to_action( cell_position( player.cell ), random_action( state, id ) ) : Action{ false, 0 };
+            }
+            state.step( actions );
+            stats_.steps++;
+        }
+
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            if( !length[id] ) continue;
+            const float reward = evaluate( state, id );
+            for( int d = 0; d < length[id]; d++ )
+            {
+                nodes_[path[id][d]].visits++;
+                nodes_[path[id][d]].value += reward;
+            }
+        }
+        stats_.iterations++;
+    }
+
+    bool over( const GameState& state ) const
+    {
+        return state.finished || !state.players[me_].alive;
+    }
+
+    uint32_t select( const Node& node ) const
+    {
+        const double log_visits = log( (double)node.visits + 1 );
+        uint32_t best = node.first_child;
+        double best_score = -1;
+        for( int c = 0; c < node.children; c++ )
+        {
+            const Node& child = nodes_[node.first_child + c];
+            if( !child.visits )
+            {
+                return node.first_child + c;
+            }
+            const double score = child.value / child.visits + exploration * sqrt( log_visits / child.visits );
+            if( score > best_score )
+            {
+                best_score = score;
+                best = node.first_child + c;
+            }
+        }
+        return best;
+    }
+
+    // Child of node reached by action, the first child when there is none
+    uint32_t child_for( uint32_t index, int action ) const
+    {
+        const Node& node = nodes_[index];
+        for( int c = 0; c < node.children; c++ )
+        {
+            if( nodes_[node.first_child + c].action == action )
+            {
+                return node.first_child + c;
+            }
+        }
+        return node.first_child;
+    }
+
+    int most_visited( int id ) const
+    {
+        if( top_[id] == none )
+        {
+            return -1;
+        }
+        const Node& top = nodes_[top_[id]];
+        int best = -1;
+        for( int c = 0; c < top.children; c++ )
+        {
+            const Node& child = nodes_[top.first_child + c];
+            if( best < 0 || child.visits > nodes_[top.first_child + best].visits )
+            {
+                best = c;
+            }
+        }
+        return best < 0 ? -1 : nodes_[top.first_child + best].action;
+    }
+
+    void expand( uint32_t index, const GameState& state, int id )
+    {
+        Node& node = nodes_[index];
+        node.expanded = true;
+        if( nodes_.size() + action_count > capacity_ )
+        {
+            return; // tree is full, keep doing rollouts from here
+        }
+
+        node.first_child = nodes_.size();
+        for( int a = 0; a < action_count; a++ )
+        {
+            if( legal( state, id, a ) )
+            {
+                Node* child = nodes_.allocate();
+                *child = Node();
+                child->action = (uint8_t)a;
+                node.children++;
+            }
+        }
+    }
+
+    // Rollout policy: random legal step, dropping a bomb only now and then
+    int random_action( const GameState& state, int id )
+    {
+        for( int attempt = 0; attempt < 8; attempt++ )
+        {
+            const int a = rng_.below( 5 ) + ( rng_.below( 6 ) ? 0 : 5 );
+            if( legal( state, id, a ) )
+            {
+                return a;
+            }
+        }
+        return 0;
+    }
+
+    // Our action, the others standing still
+    void advance( GameState& state, int action )
+    {
+        Action actions[GameState::max_players];
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            const uint8_t cell = state.players[id].cell == GameState::nowhere ? 0 : state.players[id].cell;
+            actions[id] = { false, cell };
+        }
+        actions[me_] = to_action( cell_position( state.players[me_].cell ), action );
+        state.step( actions );
+        stats_.steps++;
+    }
+
+    // Key of what the referee tells us about a position: the board, bombs, items and the players
+    // still standing. Eliminated players are simply missing from the input.
+    static uint64_t observed_key( const GameState& state )
+    {
+        uint64_t key = state.hash;
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            if( !state.players[id].alive )
+            {
+                key ^= state.player_key( id );
+            }
+        }
+        return key;
+    }
+
+    // Keeps the trees when root is what the previous root turns into under the actions the players
+    // were seen taking: every tree moves down to the child of its player's action.
+    bool resume( const GameState& root, int me, chrono::steady_clock::time_point deadline )
+    {
+        if( !reusable_ || me != me_ )
+        {
+            return false;
+        }
+        reusable_ = false;
+
+        Action played[GameState::max_players];
+        observed_actions( root_, root, played );
+        GameState next = root_;
+        next.step( played );
+        if( observed_key( next ) != observed_key( root ) )
+        {
+            return false;
+        }
+
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            if( top_[id] == none ) continue;
+            const Node& top = nodes_[top_[id]];
+            const int action = action_index( cell_position( root_.players[id].cell ), played[id] );
+            const uint32_t child = action < 0 || !top.children ? none : child_for( top_[id], action );
+            top_[id] = child != none && nodes_[child].action == action ? child : none;
+        }
+        if( top_[me_] == none )
+        {
+            return false;
+        }
+        // a pool over half full is compacted on a quarter of the turn at most, past that fresh trees are cheaper
+        const auto now = chrono::steady_clock::now();
+        if( nodes_.size() > capacity_ / 2 && !compact( nullptr, now + ( deadline - now ) / 4 ) )
+        {
+            return false;
+        }
+        root_ = root;
+        plant();
+        set_baseline();
+
+        stats_ = Stats();
+        stats_.reused = nodes_[top_[me_]].visits;
+        evaluations_.new_generation();
+        return true;
+    }
+
+    // Copies every player's tree breadth first to the front of the spare pool, keeping each child
+    // block consecutive, and swaps the pools. A raised stop or passing until abandons the copy and
+    // leaves the trees as they were.
+    bool compact( const atomic<bool>* stop, chrono::steady_clock::time_point until = chrono::steady_clock::time_point::max() )
+    {
+        uint32_t tops[GameState::max_players];
+        spare_.reset();
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            tops[id] = none;
+            if( top_[id] == none ) continue;
+            tops[id] = spare_.size();
+            *spare_.allocate() = nodes_[top_[id]];
+        }
+        for( uint32_t next = 0; next < spare_.size(); next++ )
+        {
+            if( next % 4096 == 0 && ( ( stop && stop->load( memory_order_relaxed ) ) || chrono::steady_clock::now() > until ) )
+            {
+                return false;
+            }
+            Node& copy = spare_[next];
+            if( !copy.children ) continue;
+            const uint32_t from = copy.first_child;
+            copy.first_child = spare_.size();
+            Node* block = spare_.allocate( copy.children );
+            for( int c = 0; c < copy.children; c++ )
+            {
+                block[c] = nodes_[from + c];
+            }
+        }
+        swap( nodes_, spare_ );
+        copy( tops, tops + GameState::max_players, top_ );
+        return true;
+    }
+
+    // Identical positions reached through different move orders are only scored once per turn and player
+    float evaluate( const GameState& state, int id )
+    {
+        if( !state.players[id].alive )
+        {
+            return 0;
+        }
+
+        const uint64_t key = state.hash ^ Zobrist::get().seat[id];
+        float value;
+        if( !evaluations_.probe( key, value ) )
+        {
+            value = score( state, id );
+            evaluations_.store( key, value );
+        }
+        return value;
+    }
+
+    float score( const GameState& state, int id ) const
     {
-        return !(*this == other);
-    }
+        const GameState::Player& player = state.players[id];
 
-    int row;
-    int col;
+        int own_bombs = 0;
+        state.board.bombs.for_each( [&]( int b ){ own_bombs += state.bomb_owner[b] == id; } );
+
+        return playout_value( player.boxes - root_boxes_[id], pending_boxes( state, id ), player.range, player.bombs + own_bombs,
+                              root_alive_ - state.alive_players(), threatened( state, id ) );
+    }
 };
 
-struct Field
+// Root-parallel search for machines with spare cores: every legal first move of ours gets its own tree.
+// Worker threads take turns on the trees in short time slices from their own queue and steal from the
+// others once theirs runs dry, so first moves that are slower to search do not hold anyone up.
+// At the deadline the first move with the best average outcome wins.
+// With one thread it is the plain single tree search, which can also ponder: a background thread
+// keeps growing the tree below the move just played while we wait for the referee.
+struct ParallelSearch
 {
-    static Field& get()
+    static constexpr int max_threads = 16;
+    static constexpr uint32_t branch_capacity = 1 << 17;
+    static constexpr int branch_bucket_bits = 14;
+    static constexpr auto slice = chrono::milliseconds( 2 );
+
+    // One tree by default, the engine arena and tune measure; 0 picks one thread per hardware thread.
+    // Pondering, tree reuse and opponent predictions only come with the single tree.
+    explicit ParallelSearch( int threads = 1 )
+    {
+        if( threads <= 0 )
+        {
+            threads = (int)thread::hardware_concurrency();
+        }
+        threads_ = max( 1, min( threads, max_threads ) );
+        if( threads_ == 1 )
+        {
+            single_ = make_unique<Search>();
+            return;
+        }
+
+        // every branch rolls out its own random lines
+        for( int b = 0; b < Search::action_count; b++ )
+        {
+            branches_[b] = make_unique<Search>( branch_capacity, branch_bucket_bits, Random( ( b + 1 ) * 0x9E3779B97F4A7C15ull ) );
+        }
+        for( int id = 1; id < threads_; id++ )
+        {
+            workers_.emplace_back( [this, id]{ worker( id ); } );
+        }
+    }
+
+    ~ParallelSearch()
     {
-        static Field f;
-        return f;
+        stop_ = true;
+        {
+            lock_guard<mutex> guard( lock_ );
+            quit_ = true;
+        }
+        wake_.notify_all();
+        for( thread& w: workers_ )
+        {
+            w.join();
+        }
+        if( ponderer_.joinable() )
+        {
+            ponderer_.join();
+        }
     }
 
-    void clear()
+    // Single tree on a machine with a spare hardware thread only; the thread is started on first use
+    void ponder_start()
     {
-        previous_field_ = field_;
-        field_.clear();
+        // on one core the ponder thread takes the time the main thread needs to wake up on the
+        // referee's input, and turns are answered late
+        if( threads_ != 1 || thread::hardware_concurrency() < 2 )
+        {
+            return;
+        }
+        if( !ponderer_.joinable() )
+        {
+            ponderer_ = thread( [this]{ ponder(); } );
+        }
+        {
+            lock_guard<mutex> guard( lock_ );
+            stop_ = false;
+            pondering_ = true;
+        }
+        wake_.notify_one();
     }
 
-    void update_rows(string row)
+    // Returns once the ponder thread has let go of the tree, within one batch of iterations
+    void ponder_stop()
     {
-        field_.push_back( vector<char>(row.begin(), row.end()) );
+        stop_ = true;
+        unique_lock<mutex> guard( lock_ );
+        done_.wait( guard, [this]{ return !pondering_; } );
     }
 
-    void set_character_pos(const Position& p)
+    Action best_action( const GameState& root, int me, chrono::steady_clock::time_point deadline )
     {
-        char_pos = p;
-        field_[p.row][p.col] = Symbol::character;
+        if( threads_ == 1 )
+        {
+            return single_->best_action( root, me, deadline );
+        }
+        PROFILE_SCOPE( probe_search );
+
+        // first moves dealt round robin to the workers
+        branch_count_ = 0;
+        for( int a = 0; a < Search::action_count; a++ )
+        {
+            if( !Search::legal( root, me, a ) ) continue;
+            branches_[branch_count_]->start( root, me, a );
+            branch_action_[branch_count_] = a;
+            Queue& queue = queues_[branch_count_ % threads_];
+            queue.items[queue.tail++] = branch_count_;
+            branch_count_++;
+        }
+
+        {
+            lock_guard<mutex> guard( lock_ );
+            deadline_ = deadline;
+            busy_ = threads_ - 1;
+            generation_++;
+        }
+        wake_.notify_all();
+        work( 0 );
+        {
+            unique_lock<mutex> guard( lock_ );
+            done_.wait( guard, [this]{ return busy_ == 0; } );
+        }
+        for( Queue& queue: queues_ )
+        {
+            queue.head = queue.tail = 0;
+        }
+
+        int best = -1;
+        for( int b = 0; b < branch_count_; b++ )
+        {
+            if( best < 0 || branches_[b]->mean_value() > branches_[best]->mean_value() )
+            {
+                best = b;
+            }
+        }
+        const Position at = cell_position( root.players[me].cell );
+        return best < 0 ? Action::move( at ) : Search::to_action( at, branch_action_[best] );
     }
 
-    void set_range_upgrade(const Position& p)
+    // A player's likeliest next action by the last search, -1 when unknown.
+    // Branches start with the opponents standing still, so only the single tree has a guess.
+    int predicted( int id ) const
     {
-        field_[p.row][p.col] = Symbol::range_upgrade;
+        return threads_ == 1 ? single_->predicted( id ) : -1;
     }
-    
-    bool picked_up_range_upgrade(const Position& p)
+
+    long long iterations() const
     {
-        if( !previous_field_.empty() ) // game has started
+        if( threads_ == 1 )
+        {
+            return single_->stats().iterations;
+        }
+        long long total = 0;
+        for( int b = 0; b < branch_count_; b++ )
         {
-            return previous_field_[p.row][p.col] == Symbol::range_upgrade;
+            total += branches_[b]->stats().iterations;
         }
+        return total;
     }
 
-    void set_count_upgrade(const Position& p)
+    // Formatted in place, valid until the next call
+    const char* report()
     {
-        field_[p.row][p.col] = Symbol::count_upgrade;
+        if( threads_ == 1 )
+        {
+            return single_->report();
+        }
+        snprintf( report_, sizeof report_, "Search: iterations %lld over %d first moves on %d threads", iterations(), branch_count_, threads_ );
+        return report_;
     }
-    
-    bool picked_up_count_upgrade(const Position& p)
+
+private:
+    // Branches waiting for a worker; the owner takes from the front, thieves from the back
+    struct Queue
+    {
+        mutex lock;
+        int items[Search::action_count * 2];
+        int head = 0;
+        int tail = 0;
+    };
+
+    bool take( int id, int& branch )
     {
-        if( !previous_field_.empty() ) // game has started
+        for( int k = 0; k < threads_; k++ )
         {
-            return previous_field_[p.row][p.col] == Symbol::count_upgrade;
+            Queue& queue = queues_[( id + k ) % threads_];
+            lock_guard<mutex> guard( queue.lock );
+            if( queue.head == queue.tail ) continue;
+            branch = k == 0 ? queue.items[queue.head++] : queue.items[--queue.tail];
+            return true;
         }
+        return false;
     }
 
-    void set_bomb(const Position& p, int range, int timeout)
+    void give_back( int id, int branch )
     {
-        if( field_[p.row][p.col] != Symbol::bomb ) // register only new
+        Queue& queue = queues_[id];
+        lock_guard<mutex> guard( queue.lock );
+        if( queue.tail == (int)size( queue.items ) )
         {
-            field_[p.row][p.col] = Symbol::bomb;
-            update_bomb_affected_boxes( p, range, timeout );
+            // compact, the front has been taken already
+            copy( queue.items + queue.head, queue.items + queue.tail, queue.items );
+            queue.tail -= queue.head;
+            queue.head = 0;
         }
+        queue.items[queue.tail++] = branch;
     }
-    
-    bool is_in_blast_range(const Position& p)
+
+    void work( int id )
     {
-        return field_[p.row][p.col] == Symbol::blast || field_[p.row][p.col] == Symbol::bomb ;
+        int branch;
+        while( chrono::steady_clock::now() < deadline_ && take( id, branch ) )
+        {
+            Search& search = *branches_[branch];
+            search.run( min( deadline_, chrono::steady_clock::now() + slice ) );
+            if( !search.terminal() )
+            {
+                give_back( id, branch );
+            }
+        }
     }
 
-    void update_bomb_affected_boxes(const Position& p, int range, int timeout )
+    void ponder()
     {
-        auto found_in_range = [&]( const Position& p ) -> bool
+        for( ;; )
         {
-            if( !is_in_field( p ) ) return true;
-            if( field_[p.row][p.col] == Symbol::about_to_blast || field_[p.row][p.col] == Symbol::blast ) return true; // blast zone already registered
-            if( field_[p.row][p.col] == Symbol::wall || is_field_item( field_[p.row][p.col] ) ) return true; // no blast behind a wall or items
-            if( is_field_box( field_[p.row][p.col] ) ) { field_[p.row][p.col] = Symbol::box_blasted; return true; } // count boxes, but no blast behind it
-            
-            if( timeout <= 3 )
             {
-                field_[p.row][p.col] = Symbol::about_to_blast;
+                unique_lock<mutex> guard( lock_ );
+                wake_.wait( guard, [this]{ return quit_ || pondering_; } );
+                if( quit_ ) return;
             }
-            else
+            single_->ponder( stop_ );
             {
-                field_[p.row][p.col] = Symbol::blast;
+                lock_guard<mutex> guard( lock_ );
+                pondering_ = false;
             }
-            return false; // continue search
-        };
-        
-        // rows
-        for( int r = p.row + 1; r <= p.row + range; r++ )
-        {
-            if( found_in_range( {r, p.col} ) ) break;
-        }
-        for( int r = p.row - 1; r >= p.row - range; r-- )
-        {
-            if( found_in_range( {r, p.col} ) ) break;
-        }
-        
-        // cols
-        for( int c = p.col + 1; c <= p.col + range; c++ )
-        {
-            if( found_in_range( {p.row, c} ) ) break;
-        }
-        for( int c = p.col - 1; c >= p.col - range; c-- )
-        {
-            if( found_in_range( {p.row, c} ) ) break;
+            done_.notify_one();
         }
     }
 
-    vector<Position> get_closest_boxes_from(Position from, int range = 0)
+    void worker( int id )
     {
-        vector<Position> ret;
-        const int limit = 5;
-        
-        BFSqueue( from, [&](const Position& p, vector<vector<char>>& field_copy){
-            if( field_copy[p.row][p.col] == Symbol::wall )
-            {
-                //cerr << "Pos has a wall" << endl;
-                return BFSresult::ignore;
-            }
-            
-            if( field_copy[p.row][p.col] == Symbol::box_blasted || 
-                field_copy[p.row][p.col] == Symbol::item_blasted ||
-                field_copy[p.row][p.col] == Symbol::about_to_blast )
+        int seen = 0;
+        for( ;; )
+        {
             {
-                //cerr << "Pos has a blast zone" << endl;
-                return BFSresult::ignore;
+                unique_lock<mutex> guard( lock_ );
+                wake_.wait( guard, [&]{ return quit_ || generation_ != seen; } );
+                if( quit_ ) return;
+                seen = generation_;
             }
-            
-            if( range && 
-                ( ( from.col == p.col && abs( from.row - p.row ) <= range ||
-                  ( from.row == p.row && abs( from.col - p.col ) <= range ) ) ) )
+            work( id );
             {
-                //cerr << "Pos will be affected by future bomb" << endl;
-                if( is_field_box( field_copy[p.row][p.col] ) )
-                {
-                    field_copy[p.row][p.col] = Symbol::box_blasted;
-                    field_[p.row][p.col] = Symbol::box_blasted; // for best search
-                    return BFSresult::ignore;
-                }
-                if( is_field_item( field_copy[p.row][p.col] ) )
-                {
-                    field_copy[p.row][p.col] = Symbol::item_blasted;
-                    field_[p.row][p.col] = Symbol::item_blasted; // for best search
-                    // process neighbours
-                }
-                field_[p.row][p.col] = Symbol::blast; // for best search
+                lock_guard<mutex> guard( lock_ );
+                busy_--;
             }
-            
-            if( is_field_box( field_copy[p.row][p.col] ) )
+            done_.notify_one();
+        }
+    }
+
+    int threads_ = 1;
+    unique_ptr<Search> single_; // one thread only, branches_ otherwise
+    unique_ptr<Search> branches_[Search::action_count];
+    int branch_action_[Search::action_count] = {};
+    int branch_count_ = 0;
+    Queue queues_[max_threads];
+    vector<thread> workers_;
+    thread ponderer_;
+    atomic<bool> stop_{ false };
+    bool pondering_ = false;
+    mutex lock_;
+    condition_variable wake_;
+    condition_variable done_;
+    chrono::steady_clock::time_point deadline_;
+    int generation_ = 0;
+    int busy_ = 0;
+    bool quit_ = false;
+    char report_[128];
+};
+
+// Exact play once the last box is gone and only survival and eliminations are left to decide.
+// Depth-first minimax over joint moves, deepened one turn at a time until the deadline. The
+// opponents are taken to play against us together, so a line that scores well holds whatever
+// they do: a forced kill or guaranteed survival. Opponents too far away to matter stand still.
+struct Endgame
+{
+    static constexpr int bucket_bits = 14;   // 1 MB of solved positions
+
+    Endgame(): table_( bucket_bits )
+    {}
+
+    // The move of the deepest search completed, false when not even one turn was
+    bool solve( const GameState& root, int me, chrono::steady_clock::time_point deadline, Action& best )
+    {
+        me_ = me;
+        deadline_ = deadline;
+        nodes_ = 0;
+        depth_ = 0;
+        aborted_ = false;
+        table_.new_generation();
+
+        int order[Search::action_count];
+        int count = 0;
+        for( int a = Search::action_count - 1; a >= 0; a-- )
+        {
+            if( Search::legal( root, me, a ) ) order[count++] = a;
+        }
+
+        // the game is over once no_box_turns reaches its limit
+        const int limit = max( 1, GameState::no_box_turns_limit - root.no_box_turns );
+        for( int depth = 1; depth <= limit && count; depth++ )
+        {
+            int found = 0;
+            float alpha = -infinity;
+            for( int k = 0; k < count && !aborted_; k++ )
             {
-                //cerr << "Pos found" << endl;
-                ret.push_back( p );
-                
-                if( ret.size() == limit )
+                const float value = reply( root, order[k], 0, depth, alpha, infinity );
+                if( value > alpha )
                 {
-                    return BFSresult::found; // break search
+                    alpha = value;
+                    found = k;
                 }
-                
-                return BFSresult::ignore; // do not process behind blasted box
             }
-            
-            return BFSresult::continue_search;
-        } );
+            if( aborted_ ) break;
 
-        return ret;
+            // best first for the next depth
+            rotate( order, order + found, order + found + 1 );
+            depth_ = depth;
+            value_ = alpha;
+        }
+        if( !depth_ )
+        {
+            return false;
+        }
+        best = Search::to_action( cell_position( root.players[me].cell ), order[0] );
+        return true;
+    }
+
+    // Formatted in place, valid until the next call
+    const char* report()
+    {
+        snprintf( report_, sizeof report_, "Endgame: depth %d, value %.0f, nodes %lld", depth_, value_, nodes_ );
+        return report_;
     }
 
-    Position best_place_to_bomb_around( const Position& p, const int range )
+private:
+    static constexpr float infinity = 1e9f;
+    static constexpr float survived = 1000;
+    static constexpr float trapped = 500;    // alive with no way out of the bombs already ticking
+    static constexpr float beaten = 100;     // per rival ranked below us
+
+    TranspositionTable table_;
+    chrono::steady_clock::time_point deadline_;
+    long long nodes_ = 0;
+    int me_ = 0;
+    int depth_ = 0;         // deepest search completed
+    float value_ = 0;
+    bool aborted_ = false;
+    char report_[128];
+
+    // Our move, the opponents then pick the joint reply worst for us
+    float reply( const GameState& state, int ours, int ply, int depth, float alpha, float beta )
     {
-        auto count_boxes_in_blast = [&]( const Position& p ) -> int
+        const Position at = cell_position( state.players[me_].cell );
+        int options[GameState::max_players][Search::action_count];
+        int counts[GameState::max_players];
+        for( int id = 0; id < GameState::max_players; id++ )
         {
-            int boxes = 0;
-            
-            if( is_field_box( field_[p.row][p.col] ) || field_[p.row][p.col] == Symbol::wall )
-            {
-                // can't place on box
-                return 0;
-            }
-            
-            auto found_in_range = [&]( const Position& p ) -> bool
-            {
-                if( !is_in_field( p ) ) return true;
-                if( field_[p.row][p.col] == Symbol::wall || is_field_item( field_[p.row][p.col] ) ) return true; // no blast behind a wall or items
-                if( field_[p.row][p.col] == Symbol::item_blasted || field_[p.row][p.col] == Symbol::box_blasted ) return true; // no blast behind affected by other blast
-                if( is_field_box( field_[p.row][p.col] ) ) { boxes ++; return true; } // count boxes, but no blast behind it
-                return false; // continue search
-            };
-            
-            // rows
-            for( int r = p.row + 1; r <= p.row + range; r++ )
-            {
-                if( found_in_range( {r, p.col} ) ) break;
-            }
-            for( int r = p.row - 1; r >= p.row - range; r-- )
+            counts[id] = 1;
+            options[id][0] = 0;
+            const GameState::Player& player = state.players[id];
+            if( id == me_ || !player.alive ) continue;
+            const Position p = cell_position( player.cell );
+            if( abs( p.row - at.row ) + abs( p.col - at.col ) > 2 * depth + player.range ) continue;
+
+            // bombs first, they are the replies most likely to hurt
+            counts[id] = 0;
+            for( int a = Search::action_count - 1; a >= 0; a-- )
             {
-                if( found_in_range( {r, p.col} ) ) break;
+                if( Search::legal( state, id, a ) ) options[id][counts[id]++] = a;
             }
-            
-            // cols
-            for( int c = p.col + 1; c <= p.col + range; c++ )
+        }
+
+        int pick[GameState::max_players] = {};
+        float worst = infinity;
+        for( ;; )
+        {
+            Action actions[GameState::max_players];
+            for( int id = 0; id < GameState::max_players; id++ )
             {
-                if( found_in_range( {p.row, c} ) ) break;
+                const GameState::Player& player = state.players[id];
+                const int action = id == me_ ? ours : options[id][pick[id]];
+                actions[id] = player.alive ? Search::to_action( cell_position( player.cell ), action ) : Action{ false, 0 };
             }
-            for( int c = p.col - 1; c >= p.col - range; c-- )
+            GameState next = state;
+            next.step( actions );
+            nodes_++;
+            worst = min( worst, ours_to_play( next, ply + 1, depth - 1, alpha, min( beta, worst ) ) );
+            if( worst <= alpha || aborted_ ) break;
+
+            // next joint reply, odometer style
+            int id = 0;
+            while( id < GameState::max_players && ++pick[id] == counts[id] )
             {
-                if( found_in_range( {p.row, c} ) ) break;
+                pick[id++] = 0;
             }
+            if( id == GameState::max_players ) break;
+        }
+        return worst;
+    }
 
-            return boxes;
-        };
-        
-        auto applicable = [&]( const Position& p ) -> bool
+    float ours_to_play( const GameState& state, int ply, int depth, float alpha, float beta )
+    {
+        if( state.finished || !state.players[me_].alive )
         {
-            return field_[p.row][p.col] != Symbol::character && // not Cracracter's current pos, as currently bomb is being placed here
-                   !is_obstacle( field_[p.row][p.col] ) && // not a box/wall so that bomb can be places
-                   field_[p.row][p.col] != Symbol::blast && // do not stand on other bomb's blast range
-                   has_path( char_pos, p ); // pathi to this position is clear
-        };
-
-        int best_count = 0;
-        Position best_pos = Position(-1, -1);
-        for( int r = p.row - range; r <= p.row + range; r++ )
+            return evaluate( state );
+        }
+        if( ( nodes_ & 255 ) == 0 && chrono::steady_clock::now() > deadline_ )
         {
-            if(r < 0 || r >= field_.size() || r == p.row ) continue;
-            int boxes = count_boxes_in_blast({r, p.col});
+            aborted_ = true;
+            return 0;
+        }
 
-            if( boxes > best_count && applicable( {r, p.col} ) )
-            {
-                cerr << "Position " << p.col << " " << r << " has boxes: " << boxes << endl;
-                best_count = boxes;
-                best_pos = Position(r, p.col);
-            }
+        // positions with the same hash differ in how close the game is to its end, so the ply is part of the key
+        const uint64_t key = state.hash ^ ( ( ply * 32 + depth + 1 ) * 0x9E3779B97F4A7C15ull );
+        float value;
+        if( table_.probe( key, value ) )
+        {
+            return value;
+        }
+        if( !depth )
+        {
+            value = evaluate( state );
+            table_.store( key, value );
+            return value;
         }
 
-        for( int c = p.col - range; c <= p.col + range; c++ )
+        const float window = alpha;
+        value = -infinity;
+        for( int a = Search::action_count - 1; a >= 0 && !aborted_; a-- )
+        {
+            if( !Search::legal( state, me_, a ) ) continue;
+            value = max( value, reply( state, a, ply, depth, alpha, beta ) );
+            alpha = max( alpha, value );
+            if( alpha >= beta ) break;
+        }
+        // only exact values are kept, bounds from a cut would mislead another window
+        if( !aborted_ && value > window && value < beta )
         {
-            if(c < 0 || c >= field_[0].size() || c == p.col ) continue;
-            int boxes = count_boxes_in_blast({p.row, c});
+            table_.store( key, value );
+        }
+        return value;
+    }
 
-            if( boxes > best_count && applicable( {p.row, c} ) )
+    // Survival first, then the rivals ranked below us the way the referee ranks them
+    float evaluate( const GameState& state ) const
+    {
+        const int mine = state.placement_key( me_ );
+        float value = 0;
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            if( id != me_ && state.players[id].cell != GameState::nowhere && state.placement_key( id ) < mine )
             {
-                cerr << "Position " << c << " " << p.row << " has boxes: " << boxes << endl;
-                best_count = boxes;
-                best_pos = Position(p.row, c);
+                value += beaten;
             }
         }
+        if( !state.players[me_].alive )
+        {
+            return value;
+        }
+        if( !state.finished && !can_escape( state ) )
+        {
+            value -= trapped;
+        }
+        return value + survived;
+    }
 
-        return best_pos;
+    bool can_escape( const GameState& state ) const
+    {
+        if( !state.board.bombs.any() )
+        {
+            return true;
+        }
+        uint8_t reaches[field_cells];
+        state.board.bombs.for_each( [&]( int b ){ reaches[b] = (uint8_t)( state.bomb_range[b] - 1 ); } );
+        DangerMap danger;
+        danger.compute( state.board, *state.rays, state.bomb_timer, reaches );
+        Position safe = cell_position( state.players[me_].cell );
+        return danger.escape( safe, safe ) >= 0;
     }
-    
-    Position get_closest_safe_spot_from( const Position& from )
+};
+
+// Rolling horizon evolution: a population of fixed-length plans of our own moves, the others standing
+// still, bred against the clock. Every plan keeps the state before each of its steps, so a child that
+// only differs from its parent from step k on is simulated from k; a full rescoring would redo all of
+// it. The plans of the last turn, shifted one step on, seed the next.
+struct Evolution
+{
+    static constexpr int length = 16;       // turns per plan, two bomb timers
+    static constexpr int population = 16;
+    static constexpr int fresh_plans = 4;   // the worst plans are replaced by random ones every turn
+    static constexpr float discount = 0.95f;
+
+    struct Stats
+    {
+        long long children = 0;
+        long long steps = 0;        // simulated
+        long long full_steps = 0;   // had every plan been simulated from the start
+    };
+
+    Evolution(): plans_( new Plan[population + 1] )
+    {
+        float weight = 1;
+        for( int t = 0; t < length; t++ )
+        {
+            weights_[t] = weight;
+            weight *= discount;
+        }
+        for( int i = 0; i <= population; i++ )
+        {
+            order_[i] = i;
+        }
+    }
+
+    // The first move of the best plan found by the deadline
+    Action best_action( const GameState& root, int me, chrono::steady_clock::time_point deadline )
     {
-        return BFSqueue( from, [&](const Position& p, vector<vector<char>>& field_copy){
-            if( !has_path( from, p ) )
+        me_ = me;
+        root_boxes_ = root.players[me].boxes;
+        root_alive_ = root.alive_players();
+        stats_ = Stats();
+
+        for( int i = 0; i < population; i++ )
+        {
+            Plan& plan = plans_[order_[i]];
+            plan.states[0] = root;
+            plan.values[0] = 0;
+            if( seeded_ && i < population - fresh_plans )
             {
-                //cerr << "No path" << endl;
-                return BFSresult::ignore;
+                memmove( plan.genes, plan.genes + 1, length - 1 );
+                simulate( plan, 0, length - 1 );
             }
-            
-            if( !is_obstacle( field_copy[p.row][p.col] ) && field_copy[p.row][p.col] != Symbol::blast && field_copy[p.row][p.col] != Symbol::about_to_blast )
+            else
             {
-                //cerr << "Safe pos found" << endl;
-                return BFSresult::found;
+                simulate( plan, 0, 0 );
             }
-            
-            return BFSresult::continue_search;
-        } );
-    }
-    
-    bool safe_to_bomb( const Position& p, int range )
-    {
-        auto field_backup = field_;
-        
-        set_bomb( p, range, 8 );
-        bool has_escape = get_closest_safe_spot_from( p ) != p;
-        
-        field_ = field_backup;
-        return has_escape;
+        }
+        seeded_ = true;
+        sort( order_, order_ + population, [&]( int a, int b ){ return plans_[a].fitness() > plans_[b].fitness(); } );
+
+        while( chrono::steady_clock::now() < deadline )
+        {
+            breed();
+        }
+        const Plan& best = plans_[order_[0]];
+        best_fitness_ = best.fitness();
+        return Search::to_action( cell_position( root.players[me].cell ), best.genes[0] );
     }
-    
-    bool blast_danger( const Position& p ) const
+
+    const Stats& stats() const
     {
-        return is_in_field( p ) && field_[p.row][p.col] == Symbol::about_to_blast;
+        return stats_;
     }
 
-    string print()
+    // Formatted in place, valid until the next call
+    const char* report()
     {
-        return print( field_ );
+        const int saved = stats_.full_steps ? (int)( 100 - 100 * stats_.steps / stats_.full_steps ) : 0;
+        snprintf( report_, sizeof report_, "Evolution: children %lld, steps %lld, saved %d%%, fitness %.3f",
+                  stats_.children, stats_.steps, saved, best_fitness_ );
+        return report_;
     }
-    string print( const vector<vector<char>>& f ) const
+
+private:
+    struct Plan
     {
-        string res;
-        for(const auto& row: f)
+        float fitness() const
         {
-            res += string(row.begin(), row.end()) + "\n";
+            return values[length];
         }
-        return res;
-    }
 
-    vector<vector<char>> field_;
-    vector<vector<char>> previous_field_;
-
-    enum Symbol
-    {
-        empty = '.',
-        processed = ',',
-        character = '!',
-        box = '0',
-        box_witn_range = '1',
-        box_witn_bomb = '2',
-        box_blasted = 'a',
-        item_blasted = 'b',
-        bomb = '@',
-        blast = '#',
-        about_to_blast = '$',
-        range_upgrade = 'R',
-        count_upgrade = 'C',
-        wall = 'X'
+        uint8_t genes[length];           // Search's action indices
+        GameState states[length + 1];    // before each step, states[0] is the root
+        float values[length + 1];        // discounted value collected before each step
     };
 
-private:
-    Field() {}
-    Position char_pos = {-1, -1};
-    
-    bool is_in_field( const Position& p ) const
-    {
-        return p.row >= 0 && p.row < field_.size() && p.col >= 0 && p.col < field_[0].size();
-    }
+    unique_ptr<Plan[]> plans_;          // population, and one more for the child being bred
+    int order_[population + 1];         // best plan first, the spare slot last
+    float weights_[length];
+    int me_ = 0;
+    int root_boxes_ = 0;
+    int root_alive_ = 0;
+    bool seeded_ = false;
+    float best_fitness_ = 0;
+    Stats stats_;
+    Random rng_;
+    char report_[128];
 
-    const vector<char> field_boxes = {box, box_witn_range, box_witn_bomb}; // excluding blasted boxes
-    bool is_field_box( char c ) const
-    {
-        return find( field_boxes.begin(), field_boxes.end(), c ) != field_boxes.end();
-    }
-    
-    bool is_field_item( char c ) const
+    // One child into the spare slot, from two parents crossed at a random step or one parent mutated
+    // there; it replaces the worst plan if it is better
+    void breed()
     {
-        return c == Symbol::range_upgrade || c == Symbol::count_upgrade;
+        const int k = rng_.below( length );
+        const Plan& parent = plans_[order_[tournament()]];
+        Plan& child = plans_[order_[population]];
+        memcpy( child.genes, parent.genes, sizeof child.genes );
+        copy( parent.states, parent.states + k + 1, child.states );
+        copy( parent.values, parent.values + k + 1, child.values );
+        if( rng_.below( 2 ) )
+        {
+            const Plan& other = plans_[order_[tournament()]];
+            memcpy( child.genes + k, other.genes + k, length - k );
+        }
+        else
+        {
+            child.genes[k] = (uint8_t)random_action( child.states[k] );
+        }
+        simulate( child, k, length );
+        stats_.children++;
+        stats_.full_steps += length;
+
+        // sorted insertion, the plan pushed out becomes the next spare slot
+        const float fitness = child.fitness();
+        int at = population;
+        while( at > 0 && plans_[order_[at - 1]].fitness() < fitness )
+        {
+            swap( order_[at], order_[at - 1] );
+            at--;
+        }
     }
-    
-    bool is_obstacle( char c ) const
+
+    // The better of two plans picked at random, as a rank
+    int tournament()
     {
-        return is_field_box( c ) || c == Symbol::wall || c == Symbol::box_blasted || c == Symbol::bomb;
+        const int a = rng_.below( population );
+        const int b = rng_.below( population );
+        return min( a, b );
     }
-    
-    enum BFSresult
-    {
-        ignore = -1,
-        found = 0,
-        continue_search = 1
-    };
-    Position BFSqueue( const Position& initial, function<BFSresult(const Position&, vector<vector<char>>&)> f ) const
-    {
-        queue<Position> q;
-        q.push( initial );
-        vector<vector<char>> field_copy_ = field_;
 
-        while( !q.empty() )
+    // Plays the plan from step from on, genes from fresh on are drawn anew. Genes no longer legal in
+    // the state reached are repaired: the bomb is dropped first, then the step.
+    void simulate( Plan& plan, int from, int fresh )
+    {
+        for( int t = from; t < length; t++ )
         {
-            Position next = q.front();
-            q.pop();
-            
-            //cerr << "Pos " << next.row << ":" << next.col << endl;
-            if( !is_in_field( next ) )
+            const GameState& state = plan.states[t];
+            int gene = t >= fresh ? random_action( state ) : plan.genes[t];
+            if( !Search::legal( state, me_, gene ) )
             {
-                //cerr << "Erroneous pos" << endl;
-                continue;
+                gene = gene >= 5 && Search::legal( state, me_, gene - 5 ) ? gene - 5 : 0;
             }
+            plan.genes[t] = (uint8_t)gene;
 
-            if( field_copy_[next.row][next.col] == Symbol::processed )
-            {
-                //cerr << "Pos was processed before" << endl;
-                continue;
-            }
-            
-            BFSresult f_res = f( next, field_copy_ );
-            //cerr << "BFS callback result: " << f_res << endl;
-            if( f_res == BFSresult::ignore )
-            {
-                continue;
-            }
-            else if( f_res == BFSresult::found )
+            Action actions[GameState::max_players];
+            for( int id = 0; id < GameState::max_players; id++ )
             {
-                return next;
+                const GameState::Player& player = state.players[id];
+                actions[id] = !player.alive ? Action{ false, 0 } : id == me_ ? Search::to_action( cell_position( player.cell ), gene )
+                                                                            : Action{ false, player.cell };
             }
-            // else BFSresult::continue_search
-            
-            field_copy_[next.row][next.col] = Symbol::processed;
-
-            q.push({next.row-1, next.col});
-            q.push({next.row, next.col-1});
-            q.push({next.row+1, next.col});
-            q.push({next.row, next.col+1});
+            GameState& next = plan.states[t + 1];
+            next = state;
+            next.step( actions );
+            plan.values[t + 1] = plan.values[t] + weights_[t] * value( next );
         }
-        
-        //cerr << "Not found" << endl;
-        return initial;
+        stats_.steps += length - from;
     }
-    
-    bool has_path( const Position& from, const Position& to ) const
+
+    // Search's playout value after each step, dead is worth nothing
+    float value( const GameState& state ) const
     {
-        if( !is_in_field( from ) || !is_in_field( to ) )
+        const GameState::Player& player = state.players[me_];
+        if( !player.alive )
         {
-            return false;
+            return 0;
         }
-        
-        //cerr << "Path from " << from.row << ":" << from.col << " to  " << to.row << ":" << to.col << endl;
-        return BFSqueue( from, [&](const Position& p, vector<vector<char>>& field_copy){
-            if( p == to )
-            {
-                return BFSresult::found;
-            }
-            
-            if( is_obstacle( field_copy[p.row][p.col] ) &&
-                p != char_pos ) // if standing on placed bomb path is clear
+        int own_bombs = 0;
+        state.board.bombs.for_each( [&]( int b ){ own_bombs += state.bomb_owner[b] == me_; } );
+        return playout_value( player.boxes - root_boxes_, Search::pending_boxes( state, me_ ), player.range,
+                              player.bombs + own_bombs, root_alive_ - state.alive_players(), Search::threatened( state, me_ ) );
+    }
+
+    // Random legal step, dropping a bomb only now and then, as Search's playouts do
+    int random_action( const GameState& state )
+    {
+        for( int attempt = 0; attempt < 8; attempt++ )
+        {
+            const int a = rng_.below( 5 ) + ( rng_.below( 6 ) ? 0 : 5 );
+            if( Search::legal( state, me_, a ) )
             {
-                return BFSresult::ignore;
+                return a;
             }
-            
-            return BFSresult::continue_search;
-        } ) == to;
+        }
+        return 0;
     }
 };
 
 struct Character
 {
-    static Character& get()
-    {
-        static Character c;
-        return c;
-    }
+    explicit Character( Field& f ): field( f )
+    {}
 
-    Position my_pos = nowhere;
+    Position my_pos = {-1, -1};
 
     void set_next_pos( bool will_be_bombed = false )
     {
-        vector<Position> closest_boxes = Field::get().get_closest_boxes_from( my_pos, ( will_be_bombed ? bomb_range : 0 ) );
-        
-        for( const auto& closest_box: closest_boxes )
+        if( will_be_bombed )
         {
-            cerr << "Closest "<< closest_box.col << " " << closest_box.row << endl;
-            Position best = Field::get().best_place_to_bomb_around( closest_box, bomb_range );
-            cerr << "Best "<< best.col << " " << best.row << endl;
-            if( best == nowhere )
-            {
-                cerr << "Not optimal" << endl;
-            }
-            else
-            {
-                next_pos = best;
-                return;
-            }
+            // marks what the bomb about to be placed takes out
+            field.get_closest_boxes_from( my_pos, bomb_range );
+        }
+
+        Position best = field.best_place_to_bomb( bomb_range );
+        LOG( log_debug, "Best "<< best.col << " " << best.row );
+        if( best == nowhere )
+        {
+            LOG( log_debug, "Going nowhere" );
+            return;
         }
-        cerr << "Going nowhere" << endl;
+        next_pos = best;
     }
     
     bool close_to_blast()
     {
-        return Field::get().blast_danger( {my_pos.row - 1, my_pos.col} ) ||
-               Field::get().blast_danger( {my_pos.row + 1, my_pos.col} ) ||
-               Field::get().blast_danger( {my_pos.row, my_pos.col - 1} ) ||
-               Field::get().blast_danger( {my_pos.row, my_pos.col + 1} );
+        return field.blast_danger( {my_pos.row - 1, my_pos.col} ) ||
+               field.blast_danger( {my_pos.row + 1, my_pos.col} ) ||
+               field.blast_danger( {my_pos.row, my_pos.col - 1} ) ||
+               field.blast_danger( {my_pos.row, my_pos.col + 1} );
     }
 
-    void bomb_and_move()
+    // Greedy one ply decision, returns the command to send
+    string bomb_and_move()
     {
-        update_bomb_timers();
-        
         if( next_pos == nowhere )
         {
             // Init move
             set_next_pos();
         }
         
-        if( Field::get().is_in_blast_range(next_pos) )
+        if( field.is_in_blast_range(next_pos) )
         {
             // update with newly placed bombs
             set_next_pos();
             
-            if( Field::get().is_in_blast_range(next_pos) )
+            if( field.is_in_blast_range(next_pos) )
             {
                 // end of the game, no boxes, move to nearest safe place
-                safe_pos = Field::get().get_closest_safe_spot_from( my_pos );
-                cerr << "Going to safe spot " << safe_pos.col << " " << safe_pos.row << endl;
+                safe_pos = field.get_closest_safe_spot_from( my_pos );
+                LOG( log_debug, "Going to safe spot " << safe_pos.col << " " << safe_pos.row );
             }
         }
         
-        if( Field::get().blast_danger( my_pos ) || close_to_blast() )
+        if( field.blast_danger( my_pos ) || close_to_blast() )
         {
             // get out of another bomb blast
-            safe_pos = Field::get().get_closest_safe_spot_from( my_pos );
-            cerr << "Going to safe spot " << safe_pos.col << " " << safe_pos.row << endl;
+            safe_pos = field.get_closest_safe_spot_from( my_pos );
+            LOG( log_debug, "Going to safe spot " << safe_pos.col << " " << safe_pos.row );
         }
         
-        cerr << "My pos " << my_pos.col << " " << my_pos.row << endl;
-        cerr << "Next pos " << next_pos.col << " " << next_pos.row << endl;
-        cerr << "Safe pos " << safe_pos.col << " " << safe_pos.row << endl;
-        cerr << "Bombs left " << bombs << endl;
+        LOG( log_debug, "My pos " << my_pos.col << " " << my_pos.row );
+        LOG( log_debug, "Next pos " << next_pos.col << " " << next_pos.row );
+        LOG( log_debug, "Safe pos " << safe_pos.col << " " << safe_pos.row );
+        LOG( log_debug, "Bombs left " << bombs );
         if( safe_pos != nowhere )
         {
-            cout << "Move "<< safe_pos.col << " " << safe_pos.row << endl;
+            const string command = "Move " + to_string( safe_pos.col ) + " " + to_string( safe_pos.row );
             if( my_pos == safe_pos )
             {
                 safe_pos = nowhere;
             }
+            return command;
         }
-        else if( my_pos == next_pos && bombs && Field::get().safe_to_bomb( my_pos, bomb_range ) )
+        else if( my_pos == next_pos && bombs && field.safe_to_bomb( my_pos, bomb_range ) )
         {
             set_next_pos( true );
-            bombs--;
-            bomb_timers.push_back(8);
-            cerr << "New Next pos " << next_pos.col << " " << next_pos.row << endl;
-            cout << "Bomb " << next_pos.col << " " << next_pos.row << endl;
+            LOG( log_debug, "New Next pos " << next_pos.col << " " << next_pos.row );
+            return "Bomb " + to_string( next_pos.col ) + " " + to_string( next_pos.row );
         }
         else
         {
-            cerr << "Next pos "<< next_pos.col << " " << next_pos.row << endl;
-            cout << "Move "<< next_pos.col << " " << next_pos.row << endl;
+            LOG( log_debug, "Next pos "<< next_pos.col << " " << next_pos.row );
+            return "Move " + to_string( next_pos.col ) + " " + to_string( next_pos.row );
         }
     }
 
-    void range_upgrade()
+    // bombs left and range come straight from our player entity
+    void update_stats( int bombs_left, int range )
+    {
+        bombs = bombs_left;
+        bomb_range = range - 1; // referee range counts the bomb cell itself
+    }
+
+private:
+    Field& field;
+    const Position nowhere = {-1, -1};
+    Position next_pos = nowhere;
+    Position safe_pos = nowhere;
+
+    int bomb_range = 2;
+    int bombs = 1;
+};
+
+enum Entities
+{
+    character = 0,
+    bomb = 1,
+    item = 2
+};
+
+// Splits a turn between the stages of a decision. Everything counts from the moment the first input
+// line of the turn arrived, as the referee's clock does.
+struct TimeManager
+{
+    // The referee's limits, the first turn gets ten times as long
+    static chrono::milliseconds referee_limit( int turn )
     {
-        bomb_range++;
-        cerr << "range_upgrade: " << bomb_range << endl;
+        return chrono::milliseconds( turn == 0 ? 1000 : 100 );
     }
 
-    void count_upgrade()
+    // arrived is stamped once we are awake again, later than the referee started its clock, and the
+    // answer still has to reach the referee: this much of every referee turn is never used. The
+    // arena's short in-process budgets have no pipe to cross and keep an eighth.
+    static constexpr chrono::milliseconds margin{ 12 };
+
+    // Every bomb on the board makes simulated steps slower and the engines overshoot their deadline by
+    // up to a batch, so they stop earlier the more bombs there are
+    void start( chrono::steady_clock::time_point arrived, chrono::milliseconds limit, int bombs )
     {
-        bomb_count++;
-        bombs++;
-        cerr << "count_upgrade: " << bomb_count << endl;
+        const chrono::milliseconds overshoot( min( 3 + bombs / 2, 10 ) );
+        hard_limit_ = arrived + limit - min( margin, limit / 8 );
+        engine_deadline_ = hard_limit_ - overshoot;
     }
-    
-    void check_pickups()
+
+    // The last moment to print anything at all, with room left to flush it to the referee
+    chrono::steady_clock::time_point hard_limit() const
+    {
+        return hard_limit_;
+    }
+
+    // The endgame solver, the search and the evolution stop here; the heuristic runs before them
+    // and they are skipped if it has used up their time
+    chrono::steady_clock::time_point engine_deadline() const
+    {
+        return engine_deadline_;
+    }
+
+private:
+    chrono::steady_clock::time_point hard_limit_;
+    chrono::steady_clock::time_point engine_deadline_;
+};
+
+// Makes sure a command goes out before the hard limit even if the engines are still running: the bot
+// hands over a fallback as soon as it has one, and unless the real answer comes first the watchdog
+// prints the fallback when the limit is reached.
+struct Watchdog
+{
+    Watchdog(): thread_( [this]{ run(); } )
+    {}
+
+    ~Watchdog()
     {
-        if( Field::get().picked_up_range_upgrade( my_pos ) )
         {
-            range_upgrade();
+            lock_guard<mutex> guard( lock_ );
+            quit_ = true;
         }
-        
-        if( Field::get().picked_up_count_upgrade( my_pos ) )
+        wake_.notify_one();
+        thread_.join();
+    }
+
+    // A new turn with its first fallback
+    void arm( chrono::steady_clock::time_point limit, const string& fallback )
+    {
+        {
+            lock_guard<mutex> guard( lock_ );
+            limit_ = limit;
+            answered_ = false;
+            armed_ = true;
+            copy_command( fallback );
+        }
+        wake_.notify_one();
+    }
+
+    // A better fallback, used if the limit comes first
+    void fallback( const string& command )
+    {
+        lock_guard<mutex> guard( lock_ );
+        copy_command( command );
+    }
+
+    // Prints the command, false if the fallback went out already
+    bool answer( const string& command )
+    {
         {
-            count_upgrade();
+            lock_guard<mutex> guard( lock_ );
+            if( answered_ ) return false;
+            answered_ = true;
+            cout << command << endl;
         }
+        wake_.notify_one();
+        return true;
+    }
+
+    int fired() const
+    {
+        return fired_;
     }
 
 private:
-    Character() {}
-    const Position nowhere = {-1, -1};
-    Position next_pos = nowhere;
-    Position safe_pos = nowhere;
+    void copy_command( const string& command )
+    {
+        const size_t n = min( command.size(), sizeof fallback_ - 1 );
+        memcpy( fallback_, command.data(), n );
+        fallback_[n] = 0;
+    }
 
-    int bomb_range = 2;
-    int bomb_count = 1;
-    int bombs = 1;
-    deque<int> bomb_timers;
-    
-    void update_bomb_timers()
+    void run()
     {
-        for_each( bomb_timers.begin(), bomb_timers.end(), [&]( int& timer ) { 
-            timer--; 
-            cerr << "timer: " << timer << endl;
-        });
-        while( !bomb_timers.empty() && bomb_timers.front() < 0 ) // 8 rounds inclusive, thus 0 means bomb still on field
+        unique_lock<mutex> guard( lock_ );
+        for( ;; )
         {
-            bomb_timers.pop_front();
-            bombs++;
+            wake_.wait( guard, [this]{ return quit_ || ( armed_ && !answered_ ); } );
+            if( quit_ ) return;
+            if( wake_.wait_until( guard, limit_, [this]{ return quit_ || answered_; } ) ) continue;
+            answered_ = true;
+            fired_++;
+            cout << fallback_ << endl;
         }
     }
+
+    mutex lock_;
+    condition_variable wake_;
+    chrono::steady_clock::time_point limit_;
+    bool armed_ = false;
+    bool answered_ = true;
+    bool quit_ = false;
+    atomic<int> fired_{ 0 };
+    char fallback_[32] = {};
+    thread thread_;    // last, it starts running on the members above
 };
 
-enum Entities
+// What picks the move once the Character heuristic has had its say
+enum class Engine
 {
-    character = 0,
-    bomb = 1,
-    item = 2
+    heuristic,      // the Character heuristic alone
+    search,         // Smitsimax search, pondering between turns
+    evolution       // rolling horizon evolution of our own plans
+};
+
+// One player's decision making, fed a turn of referee input at a time.
+// Holds everything that lives across turns, so several games or players can share a process.
+struct Bot
+{
+    // threads as for ParallelSearch, only the search engine uses more than one.
+    // The engines are built on the first decision, and only those the engine plays with.
+    explicit Bot( int me, Engine engine = Engine::heuristic, int threads = 1, const CharacterParams& params = default_character_params ):
+        me_( me ), engine_( engine ), threads_( threads ), field_( params ), character_( field_ )
+    {}
+
+    void start_turn()
+    {
+        field_.clear();
+        state_ = GameState();
+    }
+
+    void read_row( int row, const char* cells, int length )
+    {
+        field_.update_rows( cells, length );
+        state_.load_row( row, cells, length );
+    }
+
+    void read_entity( int type, int owner, int x, int y, int param1, int param2 )
+    {
+        switch( type )
+        {
+        case Entities::character:
+            state_.add_player( owner, {y, x}, param1, param2 );
+            if( owner == me_ )
+            {
+                character_.my_pos = Position(y, x);
+                character_.update_stats( param1, param2 );
+                field_.set_character_pos( character_.my_pos );
+            }
+            break;
+        case Entities::bomb:
+            state_.add_bomb( owner, {y, x}, param1, param2 );
+            field_.set_bomb( {y, x}, param2 - 1, param1 );
+            break;
+        case Entities::item:
+            state_.add_item( {y, x}, param1 );
+            if( param1 == 1 )
+            {
+                field_.set_range_upgrade( Position(y, x) );
+            }
+            else if( param1 == 2 )
+            {
+                field_.set_count_upgrade( Position(y, x) );
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    // The referee's limit for the turn read so far
+    chrono::milliseconds time_limit() const
+    {
+        return TimeManager::referee_limit( turn_ );
+    }
+
+    // Armed at the start of every decision with the fallback commands as they come
+    void set_watchdog( Watchdog* watchdog )
+    {
+        watchdog_ = watchdog;
+    }
+
+    // Decides the command for the turn read so far, which arrived at arrived and has limit to answer
+    string decide( chrono::steady_clock::time_point arrived, chrono::milliseconds limit )
+    {
+        clock_.start( arrived, limit, state_.board.bombs.count() );
+        if( watchdog_ )
+        {
+            const uint8_t cell = state_.players[me_].cell;
+            watchdog_->arm( clock_.hard_limit(), command_for( Action::move( cell_position( cell == GameState::nowhere ? 0 : cell ) ) ) );
+        }
+        const chrono::steady_clock::time_point deadline = clock_.engine_deadline();
+
+        if( turn_ > 0 )
+        {
+            track();
+        }
+
+        // walking distances over walls and boxes, built on the first grid and patched as boxes fall
+        if( turn_ == 0 )
+        {
+            distances_.build( state_.board );
+            rays_.clip( state_.board.walls );
+            if( engine_ == Engine::search ) search_ = make_unique<ParallelSearch>( threads_ );
+            if( engine_ != Engine::heuristic ) endgame_ = make_unique<Endgame>();
+        }
+        else
+        {
+            distances_.remove_boxes( previous_boxes_.without( state_.board.boxes ) );
+        }
+        previous_boxes_ = state_.board.boxes;
+        state_.distances = &distances_;
+        state_.rays = &rays_;
+        previous_ = state_;
+        field_.set_distances( &distances_ );
+        field_.set_blast_rays( &rays_ );
+        turn_++;
+
+        field_.update_bomb_affected_boxes();
+        LOG( log_debug, field_.print() );
+        string command = character_.bomb_and_move();
+        skip_ponder_ = false;
+        if( watchdog_ )
+        {
+            watchdog_->fallback( command );
+        }
+        if( engine_ == Engine::heuristic )
+        {
+            return command;
+        }
+        if( chrono::steady_clock::now() >= deadline )
+        {
+            LOG( log_error, "Heuristic used up the engines' time" );
+            skip_ponder_ = true;
+            return command;
+        }
+
+        // nothing left but surviving and eliminating, small enough to solve
+        if( !state_.board.boxes.any() )
+        {
+            // not even one turn solved means the deadline has passed, no engine would do better
+            Action action;
+            const bool solved = endgame_->solve( state_, me_, deadline, action );
+            LOG( log_info, endgame_->report() );
+            skip_ponder_ = true;
+            return solved ? command_for( action ) : command;
+        }
+
+        if( engine_ == Engine::evolution )
+        {
+            const Action action = evolution_.best_action( state_, me_, deadline );
+            LOG( log_info, evolution_.report() );
+            return evolution_.stats().children ? command_for( action ) : command;
+        }
+
+        const Action action = search_->best_action( state_, me_, deadline );
+        LOG( log_info, search_->report() );
+        if constexpr( HYPERSONIC_LOG_LEVEL >= log_debug )
+        {
+            for( int id = 0; id < GameState::max_players; id++ )
+            {
+                const GameState::Player& player = state_.players[id];
+                if( player.cell == GameState::nowhere ) continue;
+                const Position at = cell_position( player.cell );
+                LOG( log_debug, "Player " << id << " at " << at.col << " " << at.row << ", bombs " << (int)player.bombs <<
+                     ", range " << (int)player.range << ", boxes " << (int)player.boxes << ", next " << search_->predicted( id ) );
+            }
+        }
+        if( search_->iterations() )
+        {
+            command = command_for( action );
+        }
+        return command;
+    }
+
+    // Between our command and the next input the search keeps working on the move just sent
+    void ponder_start()
+    {
+        if( search_ && !skip_ponder_ )
+        {
+            search_->ponder_start();
+        }
+    }
+
+    void ponder_stop()
+    {
+        if( search_ )
+        {
+            search_->ponder_stop();
+        }
+    }
+
+    // Every player as last read, boxes destroyed and the game clock included
+    const GameState& state() const
+    {
+        return state_;
+    }
+
+private:
+    static string command_for( const Action& action )
+    {
+        const Position to = cell_position( action.target );
+        return ( action.place_bomb ? "Bomb " : "Move " ) + to_string( to.col ) + " " + to_string( to.row );
+    }
+
+    // The input leaves out boxes destroyed and how long the game has been going: replaying the
+    // actions every player was seen taking on the previous state fills them in
+    void track()
+    {
+        Action played[GameState::max_players];
+        observed_actions( previous_, state_, played );
+        GameState next = previous_;
+        next.step( played );
+        for( int id = 0; id < GameState::max_players; id++ )
+        {
+            if( state_.players[id].cell != GameState::nowhere )
+            {
+                state_.set_boxes( id, next.players[id].boxes );
+            }
+        }
+        state_.turn = next.turn;
+        state_.stale_turns = next.stale_turns;
+        state_.no_box_turns = next.no_box_turns;
+    }
+
+    int me_;
+    Engine engine_;
+    int threads_;
+    int turn_ = 0;
+    TimeManager clock_;
+    Watchdog* watchdog_ = nullptr;
+    Field field_;
+    Character character_;
+    unique_ptr<ParallelSearch> search_;
+    Evolution evolution_;
+    unique_ptr<Endgame> endgame_;
+    bool skip_ponder_ = false;    // the move didn't come from the search, nothing to ponder on
+    GameState state_;
+    GameState previous_;
+    DistanceTable distances_;
+    BlastRays rays_ = grid_rays;
+    Bitboard previous_boxes_;
 };
 
-int main()
+// Feeds one turn of referee input to the bot, false once the input is over.
+// turn_start is stamped when the first row arrives.
+bool read_turn( InputReader& input, Bot& bot, int height, chrono::steady_clock::time_point& turn_start )
+{
+    bot.start_turn();
+    for( int i = 0; i < height; i++ )
+    {
+        int length;
+        const char* row = input.next_word( length );
+        if( !row ) return false;
+        if( i == 0 ) turn_start = chrono::steady_clock::now();
+        bot.read_row( i, row, length );
+    }
+
+    int entities;
+    if( !input.next_int( entities ) ) return false;
+    for( int i = 0; i < entities; i++ )
+    {
+        int v[6];
+        for( int& x: v )
+        {
+            if( !input.next_int( x ) ) return false;
+        }
+        bot.read_entity( v[0], v[1], v[2], v[3], v[4], v[5] );
+    }
+    return true;
+}
+
+#ifndef HYPERSONIC_NO_MAIN
+// --record <file> copies the exact referee input to file for offline replay,
+// --threads <n> runs root-parallel search on n threads, 0 for one per hardware thread; one tree by default,
+// --engine <heuristic|search|evolution> picks what decides the move, the heuristic by default
+// until arena shows an engine ahead of it,
+// --params <file> loads the Character heuristic's knobs, as written by tune
+int main( int argc, char** argv )
 {
+    static InputReader input;
+    int threads = 1;
+    Engine engine = Engine::heuristic;
+    CharacterParams params = default_character_params;
+    for( int a = 1; a + 1 < argc; a += 2 )
+    {
+        if( !strcmp( argv[a], "--record" ) )
+        {
+            const int fd = open( argv[a + 1], O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+            if( fd < 0 )
+            {
+                cerr << "can't write " << argv[a + 1] << endl;
+                return 2;
+            }
+            input.record( fd );
+        }
+        else if( !strcmp( argv[a], "--threads" ) ) threads = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--params" ) && !load_character_params( argv[a + 1], params ) )
+        {
+            cerr << "can't load " << argv[a + 1] << endl;
+            return 2;
+        }
+        else if( !strcmp( argv[a], "--engine" ) )
+        {
+            engine = !strcmp( argv[a + 1], "search" ) ? Engine::search :
+                     !strcmp( argv[a + 1], "evolution" ) ? Engine::evolution : Engine::heuristic;
+        }
+    }
+
     int width;
     int height;
     int myId;
-    cin >> width >> height >> myId; cin.ignore();
-    //cerr << "myId: " << myId << endl;
+    if( !input.next_int( width ) || !input.next_int( height ) || !input.next_int( myId ) ) return 0;
+
+    auto bot = make_unique<Bot>( myId, engine, threads, params );
+    static Watchdog watchdog;
+    bot->set_watchdog( &watchdog );
 
     // game loop
-    while (1) {
-        Field::get().clear();
-        for (int i = 0; i < height; i++) {
-            string row;
-            cin >> row; cin.ignore();
-            //cerr << "Row: " << row << endl;
-            Field::get().update_rows(row);
-        }
-
-        int entities;
-        cin >> entities; cin.ignore();
-        for (int i = 0; i < entities; i++) {
-            int entityType;
-            int owner;
-            int x;
-            int y;
-            int param1;
-            int param2;
-            cin >> entityType >> owner >> x >> y >> param1 >> param2; cin.ignore();
-            //cerr << "Entry: " << entityType << " " << owner << " " << x << " " << y << " " << param1 << " " << param2 << endl;
-
-            switch( entityType )
-            {
-            case Entities::character:
-                if( owner == myId )
-                {
-                    Character::get().my_pos = Position(y, x);
-                    Field::get().set_character_pos( Character::get().my_pos );
-                }
-                break;
-            case Entities::bomb:
-                Field::get().set_bomb( {y, x}, param2 - 1, param1 );
-                break;
-            case Entities::item:
-                if( param1 == 1 )
-                {
-                    Field::get().set_range_upgrade( Position(y, x) );
-                }
-                else if( param1 == 2 )
-                {
-                    Field::get().set_count_upgrade( Position(y, x) );
-                }
-                break;
-            default:
-                break;
-            }
+    for( int turn = 0; ; turn++ )
+    {
+        const long long allocations_before = allocations_made;
+
+        // the referee's clock runs from the first line of the turn, pondering has to give the tree back first
+        input.wait();
+        const auto arrived = chrono::steady_clock::now();
+        bot->ponder_stop();
+
+        chrono::steady_clock::time_point turn_start;
+        if( !read_turn( input, *bot, height, turn_start ) ) // game over
+        {
+#if HYPERSONIC_PROFILE
+            LOG( log_info, Profile::get().summary() );
+#endif
+            Log::get().flush();
+            return 0;
         }
 
-        cerr << Field::get().print() << endl;
-        Character::get().check_pickups();
-        Character::get().bomb_and_move();
+        string command;
+        {
+            PROFILE_SCOPE( probe_turn );
+            command = bot->decide( arrived, bot->time_limit() );
+        }
+        if( !watchdog.answer( command ) )
+        {
+            LOG( log_error, "Too late, the watchdog sent the fallback instead of " << command );
+        }
+        bot->ponder_start();
+#if HYPERSONIC_PROFILE
+        LOG( log_info, Profile::get().end_turn() );
+#endif
+        if constexpr( HYPERSONIC_TRACK_ALLOCATIONS )
+        {
+            // the first turns fill caches and buffers, after that nothing should allocate
+            if( turn > 1 && allocations_made != allocations_before )
+            {
+                LOG( log_error, "Allocations this turn: " << allocations_made - allocations_before );
+            }
+        }
+        Log::get().flush();
     }
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,133 @@
+// Scoped timers and counters for the hot paths, for local builds with HYPERSONIC_PROFILE=1.
+// hypersonic.cpp includes it then; the submission compiles the probes out.
+#pragma once
+
+enum Probe
+{
+    probe_turn,
+    probe_clear,
+    probe_danger,
+    probe_closest_boxes,
+    probe_safe_to_bomb,
+    probe_bfs,
+    probe_search,
+    probe_count
+};
+
+enum Counter
+{
+    counter_bfs_nodes,
+    counter_has_path,
+    counter_board_copies,
+    counter_count
+};
+
+// Per thread totals for the current turn, folded into a game summary at the end of each turn
+struct Profile
+{
+    static Profile& get()
+    {
+        thread_local Profile instance;
+        return instance;
+    }
+
+    void add( Probe probe, int64_t nanoseconds )
+    {
+        time_[probe] += nanoseconds;
+        calls_[probe]++;
+    }
+
+    void count( Counter counter, int64_t n )
+    {
+        counts_[counter] += n;
+    }
+
+    // One compact line for the turn, then starts the next one
+    string end_turn()
+    {
+        string line = "Profile:";
+        for( int p = 0; p < probe_count; p++ )
+        {
+            line += string( " " ) + probe_names[p] + " " + microseconds( time_[p] ) + "/" + to_string( calls_[p] );
+            game_time_[p] += time_[p];
+        }
+        for( int c = 0; c < counter_count; c++ )
+        {
+            line += string( ", " ) + counter_names[c] + " " + to_string( counts_[c] );
+            game_counts_[c] += counts_[c];
+        }
+
+        int bucket = 0;
+        while( bucket + 1 < histogram_size && time_[probe_turn] >= histogram_limits[bucket] * 1000000 ) bucket++;
+        histogram_[bucket]++;
+        turns_++;
+
+        fill( time_, time_ + probe_count, 0 );
+        fill( calls_, calls_ + probe_count, 0 );
+        fill( counts_, counts_ + counter_count, 0 );
+        return line;
+    }
+
+    // Turn time histogram and per turn averages over the game
+    string summary() const
+    {
+        string text = "Turn time histogram:";
+        for( int b = 0; b < histogram_size; b++ )
+        {
+            text += b + 1 < histogram_size ? string( " <" ) + to_string( histogram_limits[b] ) + "ms " : string( " more " );
+            text += to_string( histogram_[b] );
+        }
+        text += "\nAverage per turn:";
+        const int turns = max( turns_, 1 );
+        for( int p = 0; p < probe_count; p++ )
+        {
+            text += string( " " ) + probe_names[p] + " " + microseconds( game_time_[p] / turns );
+        }
+        for( int c = 0; c < counter_count; c++ )
+        {
+            text += string( ", " ) + counter_names[c] + " " + to_string( game_counts_[c] / turns );
+        }
+        return text;
+    }
+
+private:
+    static constexpr const char* probe_names[probe_count] = {
+        "turn", "clear", "danger", "closest_boxes", "safe_to_bomb", "bfs", "search"
+    };
+    static constexpr const char* counter_names[counter_count] = { "bfs_nodes", "has_path", "board_copies" };
+    static constexpr int histogram_size = 8;
+    static constexpr int histogram_limits[histogram_size - 1] = { 1, 2, 5, 10, 20, 50, 100 };
+
+    static string microseconds( int64_t nanoseconds )
+    {
+        return to_string( nanoseconds / 1000 ) + "us";
+    }
+
+    int64_t time_[probe_count] = {};
+    int64_t calls_[probe_count] = {};
+    int64_t counts_[counter_count] = {};
+    int64_t game_time_[probe_count] = {};
+    int64_t game_counts_[counter_count] = {};
+    int histogram_[histogram_size] = {};
+    int turns_ = 0;
+};
+
+struct ScopedTimer
+{
+    explicit ScopedTimer( Probe probe ): probe_( probe ), start_( chrono::steady_clock::now() )
+    {}
+
+    ~ScopedTimer()
+    {
+        Profile::get().add( probe_, chrono::duration_cast<chrono::nanoseconds>( chrono::steady_clock::now() - start_ ).count() );
+    }
+
+private:
+    Probe probe_;
+    chrono::steady_clock::time_point start_;
+};
+
+#define PROFILE_JOIN( a, b ) a##b
+#define PROFILE_NAME( line ) PROFILE_JOIN( scoped_timer_, line )
+#define PROFILE_SCOPE( probe ) ScopedTimer PROFILE_NAME( __LINE__ )( probe )
+#define PROFILE_COUNT( counter, n ) Profile::get().count( counter, n )
@@ -0,0 +1,123 @@
+// Replays recorded games through the bot and reports decision time per turn, build with:
+//   g++ -std=c++17 -O2 -pthread -o replay replay.cpp
+// Record a game with `hypersonic --record game.txt`, then run `replay game.txt [more games...]`.
+// Turns that allocate once the bot has warmed up are reported too and fail the run.
+#define HYPERSONIC_NO_MAIN
+#define HYPERSONIC_LOG_LEVEL 0
+#define HYPERSONIC_TRACK_ALLOCATIONS 1
+#include "hypersonic.cpp"
+
+#include <chrono>
+#include <cstdio>
+
+namespace
+{
+
+// Turns slower than this miss the referee's deadline
+const double first_turn_limit_ms = 1000;
+const double turn_limit_ms = 100;
+
+// Turns before this one may still fill caches and buffers
+const int steady_turn = 2;
+
+struct TurnTime
+{
+    double ms;
+    int game;
+    int turn;
+    long long allocations;
+};
+
+double percentile( const vector<double>& sorted, double p )
+{
+    if( sorted.empty() ) return 0;
+    const size_t at = min( sorted.size() - 1, (size_t)( p * sorted.size() ) );
+    return sorted[at];
+}
+
+// Percentiles leave out the first turn, it runs on its own larger budget
+void report( const char* name, vector<double> times )
+{
+    sort( times.begin(), times.end() );
+    printf( "%s: turns %zu, p50 %.2f ms, p99 %.2f ms, max %.2f ms\n", name, times.size(),
+            percentile( times, 0.50 ), percentile( times, 0.99 ), times.empty() ? 0.0 : times.back() );
+}
+
+// Plays one recorded game, false if the file can't be read
+bool replay( const char* path, int game, vector<TurnTime>& turns )
+{
+    const int fd = open( path, O_RDONLY );
+    if( fd < 0 ) return false;
+    InputReader input( fd );
+
+    int width;
+    int height;
+    int me;
+    if( !input.next_int( width ) || !input.next_int( height ) || !input.next_int( me ) )
+    {
+        close( fd );
+        return false;
+    }
+
+    auto bot = make_unique<Bot>( me, Engine::search ); // the engine whose time and allocations matter
+    for( int turn = 0; ; turn++ )
+    {
+        const long long allocations_before = allocations_made;
+        chrono::steady_clock::time_point turn_start;
+        if( !read_turn( input, *bot, height, turn_start ) ) break;
+        const auto start = chrono::steady_clock::now();
+        bot->decide( start, bot->time_limit() );
+        const chrono::duration<double, milli> spent = chrono::steady_clock::now() - start;
+        const long long allocations = allocations_made - allocations_before;
+        turns.push_back( { spent.count(), game, turn, allocations } );
+    }
+    close( fd );
+    return true;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    if( argc < 2 )
+    {
+        fprintf( stderr, "usage: %s game.txt [more games...]\n", argv[0] );
+        return 2;
+    }
+
+    vector<TurnTime> turns;
+    for( int g = 1; g < argc; g++ )
+    {
+        const size_t first = turns.size();
+        if( !replay( argv[g], g, turns ) )
+        {
+            fprintf( stderr, "can't read %s\n", argv[g] );
+            return 2;
+        }
+        vector<double> times;
+        for( size_t t = first; t < turns.size(); t++ )
+        {
+            if( turns[t].turn > 0 ) times.push_back( turns[t].ms );
+        }
+        report( argv[g], times );
+    }
+
+    vector<double> later;
+    int failed = 0;
+    for( const TurnTime& t: turns )
+    {
+        if( t.turn > 0 ) later.push_back( t.ms );
+        if( t.ms > ( t.turn == 0 ? first_turn_limit_ms : turn_limit_ms ) )
+        {
+            printf( "slow: %s turn %d took %.2f ms\n", argv[t.game], t.turn, t.ms );
+            failed++;
+        }
+        if( t.turn >= steady_turn && t.allocations )
+        {
+            printf( "allocating: %s turn %d made %lld allocations\n", argv[t.game], t.turn, t.allocations );
+            failed++;
+        }
+    }
+    if( argc > 2 ) report( "all games", later );
+    return failed ? 1 : 0;
+}
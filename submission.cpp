@@ -0,0 +1,165 @@
+// Writes the file pasted into CodinGame from hypersonic.cpp, build with:
+//   g++ -std=c++17 -O2 -o submission submission.cpp
+// Comments, indentation and blank lines are stripped, the code is left as it is. The referee takes
+// at most 100,000 characters, a larger result fails the run and nothing is written.
+// e.g. submission --source hypersonic.cpp --tuned tuned_params.h --out hypersonic_submission.cpp
+// Define SUBMISSION_NO_MAIN to reuse the check from another tool.
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace submission
+{
+
+using std::string;
+
+// CodinGame rejects longer sources
+constexpr size_t max_chars = 100000;
+
+bool read_file( const string& path, string& text )
+{
+    std::ifstream in( path, std::ios::binary );
+    if( !in ) return false;
+    std::ostringstream buffer;
+    buffer << in.rdbuf();
+    text = buffer.str();
+    return true;
+}
+
+// Drops // and /* */ comments outside string and character literals. A block comment becomes a space
+// so the tokens around it stay apart, line breaks are kept.
+string strip_comments( const string& source )
+{
+    string out;
+    out.reserve( source.size() );
+    for( size_t i = 0; i < source.size(); )
+    {
+        const char c = source[i];
+        if( c == '"' || c == '\'' )
+        {
+            // copy the literal up to its closing quote, skipping escaped characters
+            size_t end = i + 1;
+            while( end < source.size() && source[end] != c && source[end] != '\n' )
+            {
+                end += source[end] == '\\' ? 2 : 1;
+            }
+            end = std::min( end + 1, source.size() );
+            out.append( source, i, end - i );
+            i = end;
+        }
+        else if( c == '/' && i + 1 < source.size() && source[i + 1] == '/' )
+        {
+            while( i < source.size() && source[i] != '\n' ) i++;
+        }
+        else if( c == '/' && i + 1 < source.size() && source[i + 1] == '*' )
+        {
+            const size_t end = source.find( "*/", i + 2 );
+            i = end == string::npos ? source.size() : end + 2;
+            out += ' ';
+        }
+        else
+        {
+            out += c;
+            i++;
+        }
+    }
+    return out;
+}
+
+// Trims every line and drops the empty ones. Preprocessor lines keep their own line, continued
+// lines keep the backslash that continues them.
+string strip_layout( const string& source )
+{
+    string out;
+    out.reserve( source.size() );
+    std::istringstream in( source );
+    for( string line; getline( in, line ); )
+    {
+        const size_t first = line.find_first_not_of( " \t\r" );
+        if( first == string::npos ) continue;
+        const size_t last = line.find_last_not_of( " \t\r" );
+        out.append( line, first, last - first + 1 );
+        out += '\n';
+    }
+    return out;
+}
+
+// Replaces the line including the header with the header itself, false if it isn't included
+bool inline_header( string& source, const string& header, const string& text )
+{
+    const string include = "#include \"" + header + "\"";
+    const size_t at = source.find( include );
+    if( at == string::npos ) return false;
+    source.replace( at, include.size(), text );
+    return true;
+}
+
+// The submission built from the bot's source, tuned knobs compiled in when given
+bool build( const string& source_path, const string& tuned_path, string& result, string& error )
+{
+    string source;
+    if( !read_file( source_path, source ) )
+    {
+        error = "can't read " + source_path;
+        return false;
+    }
+    if( !tuned_path.empty() )
+    {
+        string tuned;
+        if( !read_file( tuned_path, tuned ) )
+        {
+            error = "can't read " + tuned_path;
+            return false;
+        }
+        const size_t pragma = tuned.find( "#pragma once" );
+        if( pragma != string::npos ) tuned.erase( pragma, strlen( "#pragma once" ) );
+        if( !inline_header( source, "tuned_params.h", tuned ) )
+        {
+            error = source_path + " doesn't include tuned_params.h";
+            return false;
+        }
+        source = "#define HYPERSONIC_TUNED_PARAMS 1\n" + source;
+    }
+    result = strip_layout( strip_comments( source ) );
+    return true;
+}
+
+} // namespace submission
+
+#ifndef SUBMISSION_NO_MAIN
+int main( int argc, char** argv )
+{
+    std::string source = "hypersonic.cpp";
+    std::string tuned;
+    std::string out = "hypersonic_submission.cpp";
+    for( int a = 1; a + 1 < argc; a += 2 )
+    {
+        if( !strcmp( argv[a], "--source" ) ) source = argv[a + 1];
+        else if( !strcmp( argv[a], "--tuned" ) ) tuned = argv[a + 1];
+        else if( !strcmp( argv[a], "--out" ) ) out = argv[a + 1];
+    }
+
+    std::string result, error;
+    if( !submission::build( source, tuned, result, error ) )
+    {
+        fprintf( stderr, "%s\n", error.c_str() );
+        return 2;
+    }
+    printf( "%zu of %zu characters\n", result.size(), submission::max_chars );
+    if( result.size() > submission::max_chars )
+    {
+        fprintf( stderr, "the submission is over CodinGame's limit, nothing written\n" );
+        return 1;
+    }
+    std::ofstream file( out, std::ios::binary );
+    if( !( file << result ) )
+    {
+        fprintf( stderr, "can't write %s\n", out.c_str() );
+        return 2;
+    }
+    return 0;
+}
+#endif
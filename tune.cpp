@@ -0,0 +1,192 @@
+// Tunes the Character heuristic's knobs with SPSA over seeded self-play, build with:
+//   g++ -std=c++17 -O2 -pthread -o tune tune.cpp
+// Every iteration nudges all knobs at once in a random direction, plays the set pushed one way
+// against the set pushed the other way and steps towards the winner. The games run in parallel.
+// The result is written as a header for the submission build, -DHYPERSONIC_TUNED_PARAMS=1, and
+// printed in the format --params loads.
+// e.g. tune --iterations 200 --games 64 --out tuned_params.h
+#define ARENA_NO_MAIN
+#include "arena.cpp"
+
+#include <cmath>
+
+namespace
+{
+
+struct TuneOptions
+{
+    int iterations = 200;
+    int games = 64;                 // per iteration, an even number keeps the seats balanced
+    int threads = 0;
+    uint64_t seed = 1;
+    string bot = "baseline";        // the engine playing both sides
+    int budget_ms = 20;
+    const char* out = "tuned_params.h";
+    CharacterParams start = default_character_params;
+};
+
+constexpr int param_count = sizeof( character_param_info ) / sizeof( character_param_info[0] );
+
+// Steps of a knob worth trying at first, an eighth of its range but at least one
+double spread( const CharacterParamInfo& info )
+{
+    return max( 1.0, ( info.high - info.low ) / 8.0 );
+}
+
+CharacterParams rounded( const double x[param_count] )
+{
+    CharacterParams params;
+    for( int i = 0; i < param_count; i++ )
+    {
+        const CharacterParamInfo& info = character_param_info[i];
+        params.*info.field = max( info.low, min( (int)lround( x[i] ), info.high ) );
+    }
+    return params;
+}
+
+// Win rate of a over b minus that of b over a, in [-1, 1]
+double match( const TuneOptions& tune, const CharacterParams& a, const CharacterParams& b, uint64_t seed, int games )
+{
+    Options options;
+    options.bots = { tune.bot, tune.bot };
+    options.params = { a, b };
+    options.seed = seed;
+    options.budget_ms = tune.budget_ms;
+
+    Results results;
+    results.wins.assign( 2, 0 );
+    results.late.assign( 2, 0 );
+    results.turn_ms.assign( 2, {} );
+    atomic<int> next_game( 0 );
+    vector<thread> workers;
+    for( int t = 0; t < tune.threads; t++ )
+    {
+        workers.emplace_back( [&]{
+            for( int g; ( g = next_game++ ) < games; )
+            {
+                play( options, (uint64_t)g, results );
+            }
+        } );
+    }
+    for( thread& w: workers ) w.join();
+    return (double)( results.wins[0] - results.wins[1] ) / max( 1, results.games );
+}
+
+void print_params( FILE* out, const CharacterParams& params )
+{
+    for( const CharacterParamInfo& info: character_param_info )
+    {
+        fprintf( out, "%s %d\n", info.name, params.*info.field );
+    }
+}
+
+bool write_header( const TuneOptions& tune, const CharacterParams& params, double verified )
+{
+    FILE* out = fopen( tune.out, "w" );
+    if( !out ) return false;
+    fprintf( out, "// Written by tune: %d iterations of %d %s self-play games, seed %llu.\n",
+             tune.iterations, tune.games, tune.bot.c_str(), (unsigned long long)tune.seed );
+    fprintf( out, "// Against the starting set it scored %+.3f. Compiled in with -DHYPERSONIC_TUNED_PARAMS=1.\n", verified );
+    fprintf( out, "#pragma once\n\nconstexpr CharacterParams tuned_character_params = []{\n    CharacterParams params;\n" );
+    for( const CharacterParamInfo& info: character_param_info )
+    {
+        fprintf( out, "    params.%s = %d;\n", info.name, params.*info.field );
+    }
+    fprintf( out, "    return params;\n}();\n" );
+    return fclose( out ) == 0;
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    TuneOptions tune;
+    for( int a = 1; a + 1 < argc; a += 2 )
+    {
+        if( !strcmp( argv[a], "--iterations" ) ) tune.iterations = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--games" ) ) tune.games = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--threads" ) ) tune.threads = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--seed" ) ) tune.seed = strtoull( argv[a + 1], nullptr, 10 );
+        else if( !strcmp( argv[a], "--bot" ) ) tune.bot = argv[a + 1];
+        else if( !strcmp( argv[a], "--budget" ) ) tune.budget_ms = atoi( argv[a + 1] );
+        else if( !strcmp( argv[a], "--out" ) ) tune.out = argv[a + 1];
+        else if( !strcmp( argv[a], "--params" ) && !load_character_params( argv[a + 1], tune.start ) )
+        {
+            fprintf( stderr, "can't load %s\n", argv[a + 1] );
+            return 2;
+        }
+    }
+    if( tune.iterations <= 0 || tune.games <= 0 || tune.bot.compare( 0, 4, "cmd:" ) == 0 )
+    {
+        fprintf( stderr, "usage: %s [--iterations n] [--games n] [--threads n] [--seed s] [--bot search|evolution|baseline] "
+                 "[--budget ms] [--params file] [--out header]\n", argv[0] );
+        return 2;
+    }
+    if( tune.threads <= 0 ) tune.threads = max( 1u, thread::hardware_concurrency() );
+
+    // the usual gain sequences, a_k = a / ( k + 1 + A )^0.602 and c_k = c / ( k + 1 )^0.101,
+    // in units of each knob's spread
+    const double a = 1.0;
+    const double big_a = tune.iterations / 10.0;
+    const double c = 1.0;
+
+    double x[param_count];
+    for( int i = 0; i < param_count; i++ )
+    {
+        x[i] = tune.start.*character_param_info[i].field;
+    }
+
+    Random rng( tune.seed * 0x9E3779B97F4A7C15ull + 1 );
+    uint64_t next_seed = tune.seed;
+    const auto start = chrono::steady_clock::now();
+    for( int k = 0; k < tune.iterations; k++ )
+    {
+        const double a_k = a / pow( k + 1 + big_a, 0.602 );
+        const double c_k = c / pow( k + 1, 0.101 );
+
+        double plus[param_count];
+        double minus[param_count];
+        int delta[param_count];
+        for( int i = 0; i < param_count; i++ )
+        {
+            delta[i] = rng.below( 2 ) ? 1 : -1;
+            const double step = max( 1.0, round( c_k * spread( character_param_info[i] ) ) );
+            plus[i] = round( x[i] ) + delta[i] * step;
+            minus[i] = round( x[i] ) - delta[i] * step;
+        }
+
+        // fresh maps every iteration, the seats swap within it
+        const double outcome = match( tune, rounded( plus ), rounded( minus ), next_seed, tune.games );
+        next_seed += tune.games;
+        for( int i = 0; i < param_count; i++ )
+        {
+            const CharacterParamInfo& info = character_param_info[i];
+            x[i] = max( (double)info.low, min( x[i] + a_k * outcome * delta[i] * spread( info ), (double)info.high ) );
+        }
+
+        if( ( k + 1 ) % 10 == 0 || k + 1 == tune.iterations )
+        {
+            const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+            printf( "iteration %d, %.0f s, last outcome %+.3f:", k + 1, elapsed.count(), outcome );
+            const CharacterParams now = rounded( x );
+            for( const CharacterParamInfo& info: character_param_info )
+            {
+                printf( " %s %d", info.name, now.*info.field );
+            }
+            printf( "\n" );
+            fflush( stdout );
+        }
+    }
+
+    // on maps none of the iterations played
+    const CharacterParams best = rounded( x );
+    const double verified = match( tune, best, tune.start, next_seed, tune.games * 4 );
+    printf( "against the starting set over %d games: %+.3f\n", tune.games * 4, verified );
+    print_params( stdout, best );
+    if( !write_header( tune, best, verified ) )
+    {
+        fprintf( stderr, "can't write %s\n", tune.out );
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Playing turns in place and taking them back, for the offline tools; include it after hypersonic.cpp.
+// The benchmark weighs it against copying the state: at this state size the copy is cheaper,
+// so the engines copy.
+#pragma once
+
+// Fixed undo stack, one record per applied turn
+struct UndoLog
+{
+    static constexpr int capacity = 64;
+    static constexpr int max_players = GameState::max_players;
+
+    // Bomb arrays at one cell before a turn wrote them
+    struct BombSlot
+    {
+        uint8_t cell;
+        uint8_t timer;
+        uint8_t owner;
+        uint8_t range;
+    };
+
+    // Everything a turn can overwrite: the planes it touches, players and counters, plus the bomb slots
+    // it wrote, kept in the slot stack. Box planes only change when something explodes.
+    struct Undo
+    {
+        Bitboard range_items, count_items, bombs;
+        Bitboard boxes, range_boxes, count_boxes;
+        bool detonation;
+        GameState::Player players[max_players];
+        uint64_t hash;
+        int16_t turn;
+        uint8_t stale_turns;
+        uint8_t no_box_turns;
+        bool finished;
+        uint16_t first_slot;
+    };
+
+    void clear()
+    {
+        depth = 0;
+        slot_count = 0;
+    }
+
+    Undo turns[capacity];
+    BombSlot slots[capacity * ( field_cells + max_players )]; // a turn writes at most every bomb and one per player
+    int depth = 0;
+    int slot_count = 0;
+};
+
+// step() that can be taken back with undo(), costs the touched planes and bomb slots instead of a copy.
+// False, with nothing played, once the log is full.
+inline bool apply( GameState& state, const Action actions[GameState::max_players], UndoLog& log )
+{
+    if( log.depth == UndoLog::capacity )
+    {
+        return false;
+    }
+
+    UndoLog::Undo& undo = log.turns[log.depth++];
+    undo.range_items = state.board.range_items;
+    undo.count_items = state.board.count_items;
+    undo.bombs = state.board.bombs;
+    copy( state.players, state.players + GameState::max_players, undo.players );
+    undo.hash = state.hash;
+    undo.turn = state.turn;
+    undo.stale_turns = state.stale_turns;
+    undo.no_box_turns = state.no_box_turns;
+    undo.finished = state.finished;
+    undo.first_slot = (uint16_t)log.slot_count;
+
+    // timers tick on every bomb, new ones go under the players
+    undo.detonation = false;
+    auto save = [&]( int i ){
+        log.slots[log.slot_count++] = { (uint8_t)i, state.bomb_timer[i], state.bomb_owner[i], state.bomb_range[i] };
+        undo.detonation |= state.bomb_timer[i] == 1;
+    };
+    state.board.bombs.for_each( save );
+    if( undo.detonation )
+    {
+        undo.boxes = state.board.boxes;
+        undo.range_boxes = state.board.range_boxes;
+        undo.count_boxes = state.board.count_boxes;
+    }
+    for( const GameState::Player& player: state.players )
+    {
+        if( player.alive ) save( player.cell );
+    }
+
+    state.step( actions );
+    return true;
+}
+
+// Takes back the last applied turn
+inline void undo( GameState& state, UndoLog& log )
+{
+    const UndoLog::Undo& undo = log.turns[--log.depth];
+    while( log.slot_count > undo.first_slot )
+    {
+        const UndoLog::BombSlot& slot = log.slots[--log.slot_count];
+        state.bomb_timer[slot.cell] = slot.timer;
+        state.bomb_owner[slot.cell] = slot.owner;
+        state.bomb_range[slot.cell] = slot.range;
+    }
+    if( undo.detonation )
+    {
+        state.board.boxes = undo.boxes;
+        state.board.range_boxes = undo.range_boxes;
+        state.board.count_boxes = undo.count_boxes;
+    }
+    state.board.range_items = undo.range_items;
+    state.board.count_items = undo.count_items;
+    state.board.bombs = undo.bombs;
+    copy( undo.players, undo.players + GameState::max_players, state.players );
+    state.hash = undo.hash;
+    state.turn = undo.turn;
+    state.stale_turns = undo.stale_turns;
+    state.no_box_turns = undo.no_box_turns;
+    state.finished = undo.finished;
+}